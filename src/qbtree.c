@@ -0,0 +1,805 @@
+/**
+ * B+ tree with cache-line sized nodes
+ *
+ * @version 2026-10-16_001
+ * @author  Robert Altnoeder (r.altnoeder@gmx.net)
+ *
+ * Copyright (C) 2026 Robert ALTNOEDER
+ *
+ * Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that
+ * the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "qbtree.h"
+
+// An inner node with 31 keys and 32 children occupies 8 cache lines of 64 bytes
+#define QBTREE_INNER_KEYS   31
+#define QBTREE_INNER_MIN    (QBTREE_INNER_KEYS / 2)
+#define QBTREE_LEAF_ENTRIES 32
+#define QBTREE_LEAF_MIN     (QBTREE_LEAF_ENTRIES / 2)
+// Sufficient for any number of entries that fits into a size_t
+#define QBTREE_MAX_HEIGHT   16
+
+typedef struct qbtree_inner_s qbtree_inner;
+
+struct qbtree_inner_s
+{
+    size_t      count;
+    const void  *keys[QBTREE_INNER_KEYS];
+    void        *children[QBTREE_INNER_KEYS + 1];
+};
+
+struct qbtree_leaf_s
+{
+    size_t          count;
+    qbtree_leaf     *next;
+    qbtree_leaf     *prev;
+    qbtree_entry    entries[QBTREE_LEAF_ENTRIES];
+};
+
+static inline size_t      qbtree_impl_inner_index(
+    const qbtree        *qbtree_obj,
+    const qbtree_inner  *inner,
+    const void          *key
+);
+static inline size_t      qbtree_impl_leaf_index(
+    const qbtree        *qbtree_obj,
+    const qbtree_leaf   *leaf,
+    const void          *key,
+    bool                *found
+);
+static inline qbtree_leaf *qbtree_impl_find_leaf(
+    const qbtree    *qbtree_obj,
+    const void      *key,
+    qbtree_inner    **path,
+    size_t          *path_idx
+);
+static inline qbtree_rc   qbtree_impl_split_insert(
+    qbtree          *qbtree_obj,
+    qbtree_inner    **path,
+    const size_t    *path_idx,
+    qbtree_leaf     *leaf,
+    size_t          pos,
+    const void      *key,
+    const void      *value
+);
+static inline void        qbtree_impl_rebalance_remove(
+    qbtree          *qbtree_obj,
+    qbtree_inner    **path,
+    const size_t    *path_idx,
+    qbtree_leaf     *leaf
+);
+static inline void        qbtree_impl_inner_erase(qbtree_inner *inner, size_t key_idx);
+static void               qbtree_impl_free_subtree(void *node, size_t height);
+static inline void        qbtree_impl_init(qbtree *qbtree_obj, qbtree_cmp_func cmp_func_ptr);
+
+
+qbtree *qbtree_alloc(const qbtree_cmp_func cmp_func_ptr)
+{
+    qbtree *qbtree_obj = malloc(sizeof (qbtree));
+    if (qbtree_obj != NULL)
+    {
+        qbtree_impl_init(qbtree_obj, cmp_func_ptr);
+    }
+
+    return qbtree_obj;
+}
+
+
+void qbtree_dealloc(qbtree *qbtree_obj)
+{
+    if (qbtree_obj != NULL && qbtree_obj->root != NULL)
+    {
+        qbtree_impl_free_subtree(qbtree_obj->root, qbtree_obj->height);
+    }
+    free(qbtree_obj);
+}
+
+
+void qbtree_clear(qbtree *qbtree_obj)
+{
+    if (qbtree_obj->root != NULL)
+    {
+        qbtree_impl_free_subtree(qbtree_obj->root, qbtree_obj->height);
+    }
+    qbtree_obj->root   = NULL;
+    qbtree_obj->head   = NULL;
+    qbtree_obj->height = 0;
+    qbtree_obj->size   = 0;
+}
+
+
+void qbtree_init(qbtree *qbtree_obj, const qbtree_cmp_func cmp_func_ptr)
+{
+    qbtree_impl_init(qbtree_obj, cmp_func_ptr);
+}
+
+
+qbtree_rc qbtree_insert(qbtree *qbtree_obj, const void *key, const void *value)
+{
+    qbtree_rc rc = QBTREE_PASS;
+
+    if (qbtree_obj->root == NULL)
+    {
+        qbtree_leaf *leaf = malloc(sizeof (qbtree_leaf));
+        if (leaf != NULL)
+        {
+            leaf->count            = 1;
+            leaf->next             = NULL;
+            leaf->prev             = NULL;
+            leaf->entries[0].key   = key;
+            leaf->entries[0].value = value;
+            qbtree_obj->root       = leaf;
+            qbtree_obj->head       = leaf;
+            qbtree_obj->size       = 1;
+        }
+        else
+        {
+            rc = QBTREE_ERR_NOMEM;
+        }
+    }
+    else
+    {
+        qbtree_inner *path[QBTREE_MAX_HEIGHT];
+        size_t path_idx[QBTREE_MAX_HEIGHT];
+        qbtree_leaf *leaf = qbtree_impl_find_leaf(qbtree_obj, key, path, path_idx);
+
+        bool found = false;
+        const size_t pos = qbtree_impl_leaf_index(qbtree_obj, leaf, key, &found);
+        if (found)
+        {
+            rc = QBTREE_ERR_EXISTS;
+        }
+        else
+        if (leaf->count < QBTREE_LEAF_ENTRIES)
+        {
+            for (size_t idx = leaf->count; idx > pos; --idx)
+            {
+                leaf->entries[idx] = leaf->entries[idx - 1];
+            }
+            leaf->entries[pos].key   = key;
+            leaf->entries[pos].value = value;
+            ++(leaf->count);
+            ++(qbtree_obj->size);
+        }
+        else
+        {
+            rc = qbtree_impl_split_insert(qbtree_obj, path, path_idx, leaf, pos, key, value);
+        }
+    }
+
+    return rc;
+}
+
+
+void qbtree_remove(qbtree *qbtree_obj, const void *key)
+{
+    if (qbtree_obj->root != NULL)
+    {
+        qbtree_inner *path[QBTREE_MAX_HEIGHT];
+        size_t path_idx[QBTREE_MAX_HEIGHT];
+        qbtree_leaf *leaf = qbtree_impl_find_leaf(qbtree_obj, key, path, path_idx);
+
+        bool found = false;
+        const size_t pos = qbtree_impl_leaf_index(qbtree_obj, leaf, key, &found);
+        if (found)
+        {
+            --(leaf->count);
+            for (size_t idx = pos; idx < leaf->count; ++idx)
+            {
+                leaf->entries[idx] = leaf->entries[idx + 1];
+            }
+            --(qbtree_obj->size);
+
+            if (qbtree_obj->height == 0)
+            {
+                if (leaf->count == 0)
+                {
+                    free(leaf);
+                    qbtree_obj->root = NULL;
+                    qbtree_obj->head = NULL;
+                }
+            }
+            else
+            if (leaf->count < QBTREE_LEAF_MIN)
+            {
+                qbtree_impl_rebalance_remove(qbtree_obj, path, path_idx, leaf);
+            }
+        }
+    }
+}
+
+
+void *qbtree_get(const qbtree *qbtree_obj, const void *key)
+{
+    const void *value = NULL;
+    qbtree_entry *entry = qbtree_get_entry(qbtree_obj, key);
+    if (entry != NULL)
+    {
+        value = entry->value;
+    }
+    return (void *) value;
+}
+
+
+/**
+ * Returns the entry with the specified key
+ *
+ * The entry is only valid until the next modification of the tree.
+ */
+qbtree_entry *qbtree_get_entry(const qbtree *qbtree_obj, const void *key)
+{
+    qbtree_entry *entry = NULL;
+    if (qbtree_obj->root != NULL)
+    {
+        qbtree_leaf *leaf = qbtree_impl_find_leaf(qbtree_obj, key, NULL, NULL);
+
+        bool found = false;
+        const size_t pos = qbtree_impl_leaf_index(qbtree_obj, leaf, key, &found);
+        if (found)
+        {
+            entry = &(leaf->entries[pos]);
+        }
+    }
+    return entry;
+}
+
+
+size_t qbtree_get_size(const qbtree *qbtree_obj)
+{
+    return qbtree_obj->size;
+}
+
+
+qbtree_it *qbtree_iterator(const qbtree *qbtree_obj)
+{
+    qbtree_it *iter = malloc(sizeof (qbtree_it));
+    if (iter != NULL)
+    {
+        qbtree_iterator_init(qbtree_obj, iter);
+    }
+    return iter;
+}
+
+
+void qbtree_iterator_init(const qbtree *qbtree_obj, qbtree_it *iter)
+{
+    iter->leaf  = qbtree_obj->head;
+    iter->index = 0;
+}
+
+
+/**
+ * Initializes an iterator that starts at the first key that is greater than
+ * or equal to the specified key
+ */
+void qbtree_iterator_seek(const qbtree *qbtree_obj, qbtree_it *iter, const void *key)
+{
+    iter->leaf  = NULL;
+    iter->index = 0;
+    if (qbtree_obj->root != NULL)
+    {
+        qbtree_leaf *leaf = qbtree_impl_find_leaf(qbtree_obj, key, NULL, NULL);
+
+        bool found = false;
+        const size_t pos = qbtree_impl_leaf_index(qbtree_obj, leaf, key, &found);
+        if (pos < leaf->count)
+        {
+            iter->leaf  = leaf;
+            iter->index = pos;
+        }
+        else
+        {
+            iter->leaf = leaf->next;
+        }
+    }
+}
+
+
+/**
+ * Returns the next entry in ascending order of keys
+ *
+ * Modifying the tree invalidates the iterator.
+ */
+qbtree_entry *qbtree_next(qbtree_it *iter)
+{
+    qbtree_entry *entry = NULL;
+    qbtree_leaf *leaf = iter->leaf;
+    if (leaf != NULL)
+    {
+        entry = &(leaf->entries[iter->index]);
+        ++(iter->index);
+        if (iter->index >= leaf->count)
+        {
+            iter->leaf  = leaf->next;
+            iter->index = 0;
+        }
+    }
+    return entry;
+}
+
+
+/**
+ * @return index of the child that may contain the specified key
+ */
+static inline size_t qbtree_impl_inner_index(
+    const qbtree        *qbtree_obj,
+    const qbtree_inner  *inner,
+    const void          *key
+)
+{
+    size_t start_idx = 0;
+    size_t end_idx   = inner->count;
+    while (start_idx < end_idx)
+    {
+        const size_t mid_idx = start_idx + (end_idx - start_idx) / 2;
+        if (qbtree_obj->qbtree_cmp(key, inner->keys[mid_idx]) < 0)
+        {
+            end_idx = mid_idx;
+        }
+        else
+        {
+            start_idx = mid_idx + 1;
+        }
+    }
+    return start_idx;
+}
+
+
+/**
+ * @return index of the entry with the specified key, or the index where the
+ *         key would be inserted if there is no such entry
+ */
+static inline size_t qbtree_impl_leaf_index(
+    const qbtree        *qbtree_obj,
+    const qbtree_leaf   *leaf,
+    const void          *key,
+    bool                *found
+)
+{
+    size_t start_idx = 0;
+    size_t end_idx   = leaf->count;
+    while (start_idx < end_idx)
+    {
+        const size_t mid_idx = start_idx + (end_idx - start_idx) / 2;
+        const int cmp_rc = qbtree_obj->qbtree_cmp(key, leaf->entries[mid_idx].key);
+        if (cmp_rc < 0)
+        {
+            end_idx = mid_idx;
+        }
+        else
+        if (cmp_rc > 0)
+        {
+            start_idx = mid_idx + 1;
+        }
+        else
+        {
+            *found    = true;
+            start_idx = mid_idx;
+            break;
+        }
+    }
+    return start_idx;
+}
+
+
+/**
+ * Descends to the leaf that may contain the specified key
+ *
+ * If path is not NULL, the inner nodes on the way and the index of the child
+ * selected in each inner node are recorded in path and path_idx.
+ */
+static inline qbtree_leaf *qbtree_impl_find_leaf(
+    const qbtree    *qbtree_obj,
+    const void      *key,
+    qbtree_inner    **path,
+    size_t          *path_idx
+)
+{
+    void *node = qbtree_obj->root;
+    for (size_t level = 0; level < qbtree_obj->height; ++level)
+    {
+        qbtree_inner *inner = node;
+        const size_t idx = qbtree_impl_inner_index(qbtree_obj, inner, key);
+        if (path != NULL)
+        {
+            path[level]     = inner;
+            path_idx[level] = idx;
+        }
+        node = inner->children[idx];
+    }
+    return node;
+}
+
+
+/**
+ * Inserts an entry into a full leaf, splitting the leaf and as many of its
+ * ancestors as necessary
+ *
+ * All nodes required for the split are allocated first, so the tree remains
+ * unchanged if an allocation fails.
+ */
+static inline qbtree_rc qbtree_impl_split_insert(
+    qbtree          *qbtree_obj,
+    qbtree_inner    **path,
+    const size_t    *path_idx,
+    qbtree_leaf     *leaf,
+    const size_t    pos,
+    const void      *key,
+    const void      *value
+)
+{
+    qbtree_rc rc = QBTREE_PASS;
+
+    // Determine the number of full ancestors that must be split as well
+    size_t split_level = qbtree_obj->height;
+    while (split_level > 0 && path[split_level - 1]->count == QBTREE_INNER_KEYS)
+    {
+        --split_level;
+    }
+    // A new root is required if all ancestors are split
+    const size_t inner_count = qbtree_obj->height - split_level + (split_level == 0 ? 1 : 0);
+
+    qbtree_inner *inner_list[QBTREE_MAX_HEIGHT + 1];
+    size_t alloc_count = 0;
+    qbtree_leaf *new_leaf = malloc(sizeof (qbtree_leaf));
+    if (new_leaf != NULL)
+    {
+        while (alloc_count < inner_count)
+        {
+            inner_list[alloc_count] = malloc(sizeof (qbtree_inner));
+            if (inner_list[alloc_count] == NULL)
+            {
+                break;
+            }
+            ++alloc_count;
+        }
+    }
+    if (new_leaf == NULL || alloc_count < inner_count)
+    {
+        while (alloc_count > 0)
+        {
+            --alloc_count;
+            free(inner_list[alloc_count]);
+        }
+        free(new_leaf);
+        rc = QBTREE_ERR_NOMEM;
+    }
+    else
+    {
+        // Split the leaf, the lower half of the entries remains in the existing leaf
+        qbtree_entry merge_entries[QBTREE_LEAF_ENTRIES + 1];
+        for (size_t idx = 0; idx < pos; ++idx)
+        {
+            merge_entries[idx] = leaf->entries[idx];
+        }
+        merge_entries[pos].key   = key;
+        merge_entries[pos].value = value;
+        for (size_t idx = pos; idx < QBTREE_LEAF_ENTRIES; ++idx)
+        {
+            merge_entries[idx + 1] = leaf->entries[idx];
+        }
+
+        const size_t less_count = (QBTREE_LEAF_ENTRIES + 1) / 2;
+        for (size_t idx = 0; idx < less_count; ++idx)
+        {
+            leaf->entries[idx] = merge_entries[idx];
+        }
+        for (size_t idx = less_count; idx < QBTREE_LEAF_ENTRIES + 1; ++idx)
+        {
+            new_leaf->entries[idx - less_count] = merge_entries[idx];
+        }
+        leaf->count     = less_count;
+        new_leaf->count = QBTREE_LEAF_ENTRIES + 1 - less_count;
+
+        new_leaf->prev = leaf;
+        new_leaf->next = leaf->next;
+        if (leaf->next != NULL)
+        {
+            leaf->next->prev = new_leaf;
+        }
+        leaf->next = new_leaf;
+        ++(qbtree_obj->size);
+
+        // Insert the separator into the ancestors, splitting full ancestors
+        const void *sep_key = new_leaf->entries[0].key;
+        void *sep_child = new_leaf;
+        size_t level = qbtree_obj->height;
+        while (sep_child != NULL && level > 0)
+        {
+            --level;
+            qbtree_inner *inner = path[level];
+            const size_t idx    = path_idx[level];
+            if (inner->count < QBTREE_INNER_KEYS)
+            {
+                for (size_t move_idx = inner->count; move_idx > idx; --move_idx)
+                {
+                    inner->keys[move_idx]         = inner->keys[move_idx - 1];
+                    inner->children[move_idx + 1] = inner->children[move_idx];
+                }
+                inner->keys[idx]         = sep_key;
+                inner->children[idx + 1] = sep_child;
+                ++(inner->count);
+                sep_child = NULL;
+            }
+            else
+            {
+                const void *merge_keys[QBTREE_INNER_KEYS + 1];
+                void *merge_children[QBTREE_INNER_KEYS + 2];
+                for (size_t move_idx = 0; move_idx < idx; ++move_idx)
+                {
+                    merge_keys[move_idx] = inner->keys[move_idx];
+                }
+                merge_keys[idx] = sep_key;
+                for (size_t move_idx = idx; move_idx < QBTREE_INNER_KEYS; ++move_idx)
+                {
+                    merge_keys[move_idx + 1] = inner->keys[move_idx];
+                }
+                for (size_t move_idx = 0; move_idx <= idx; ++move_idx)
+                {
+                    merge_children[move_idx] = inner->children[move_idx];
+                }
+                merge_children[idx + 1] = sep_child;
+                for (size_t move_idx = idx + 1; move_idx <= QBTREE_INNER_KEYS; ++move_idx)
+                {
+                    merge_children[move_idx + 1] = inner->children[move_idx];
+                }
+
+                // The middle key moves up to the parent
+                qbtree_inner *new_inner = inner_list[--alloc_count];
+                const size_t less_keys = (QBTREE_INNER_KEYS + 1) / 2;
+                for (size_t move_idx = 0; move_idx < less_keys; ++move_idx)
+                {
+                    inner->keys[move_idx]     = merge_keys[move_idx];
+                    inner->children[move_idx] = merge_children[move_idx];
+                }
+                inner->children[less_keys] = merge_children[less_keys];
+                inner->count = less_keys;
+
+                const size_t greater_keys = QBTREE_INNER_KEYS - less_keys;
+                for (size_t move_idx = 0; move_idx < greater_keys; ++move_idx)
+                {
+                    new_inner->keys[move_idx]     = merge_keys[less_keys + 1 + move_idx];
+                    new_inner->children[move_idx] = merge_children[less_keys + 1 + move_idx];
+                }
+                new_inner->children[greater_keys] = merge_children[QBTREE_INNER_KEYS + 1];
+                new_inner->count = greater_keys;
+
+                sep_key   = merge_keys[less_keys];
+                sep_child = new_inner;
+            }
+        }
+
+        if (sep_child != NULL)
+        {
+            qbtree_inner *new_root = inner_list[--alloc_count];
+            new_root->count       = 1;
+            new_root->keys[0]     = sep_key;
+            new_root->children[0] = qbtree_obj->root;
+            new_root->children[1] = sep_child;
+            qbtree_obj->root      = new_root;
+            ++(qbtree_obj->height);
+        }
+    }
+
+    return rc;
+}
+
+
+/**
+ * Refills or merges a leaf that has fewer than the minimum number of entries,
+ * and continues with each ancestor that is left with too few keys
+ */
+static inline void qbtree_impl_rebalance_remove(
+    qbtree          *qbtree_obj,
+    qbtree_inner    **path,
+    const size_t    *path_idx,
+    qbtree_leaf     *leaf
+)
+{
+    size_t level = qbtree_obj->height - 1;
+    qbtree_inner *parent = path[level];
+    size_t idx = path_idx[level];
+
+    qbtree_leaf *less_leaf    = idx > 0 ? parent->children[idx - 1] : NULL;
+    qbtree_leaf *greater_leaf = idx < parent->count ? parent->children[idx + 1] : NULL;
+    if (less_leaf != NULL && less_leaf->count > QBTREE_LEAF_MIN)
+    {
+        // borrow the greatest entry of the less sibling
+        for (size_t move_idx = leaf->count; move_idx > 0; --move_idx)
+        {
+            leaf->entries[move_idx] = leaf->entries[move_idx - 1];
+        }
+        --(less_leaf->count);
+        leaf->entries[0] = less_leaf->entries[less_leaf->count];
+        ++(leaf->count);
+        parent->keys[idx - 1] = leaf->entries[0].key;
+        parent = NULL;
+    }
+    else
+    if (greater_leaf != NULL && greater_leaf->count > QBTREE_LEAF_MIN)
+    {
+        // borrow the least entry of the greater sibling
+        leaf->entries[leaf->count] = greater_leaf->entries[0];
+        ++(leaf->count);
+        --(greater_leaf->count);
+        for (size_t move_idx = 0; move_idx < greater_leaf->count; ++move_idx)
+        {
+            greater_leaf->entries[move_idx] = greater_leaf->entries[move_idx + 1];
+        }
+        parent->keys[idx] = greater_leaf->entries[0].key;
+        parent = NULL;
+    }
+    else
+    {
+        // merge the greater one of two adjacent leaves into the less one
+        size_t key_idx = idx;
+        if (less_leaf != NULL)
+        {
+            greater_leaf = leaf;
+            --key_idx;
+        }
+        else
+        {
+            less_leaf = leaf;
+        }
+        for (size_t move_idx = 0; move_idx < greater_leaf->count; ++move_idx)
+        {
+            less_leaf->entries[less_leaf->count + move_idx] = greater_leaf->entries[move_idx];
+        }
+        less_leaf->count += greater_leaf->count;
+        less_leaf->next = greater_leaf->next;
+        if (greater_leaf->next != NULL)
+        {
+            greater_leaf->next->prev = less_leaf;
+        }
+        free(greater_leaf);
+        qbtree_impl_inner_erase(parent, key_idx);
+    }
+
+    while (parent != NULL)
+    {
+        if (level == 0)
+        {
+            if (parent->count == 0)
+            {
+                // the root has a single child, which becomes the new root
+                qbtree_obj->root = parent->children[0];
+                --(qbtree_obj->height);
+                free(parent);
+            }
+            break;
+        }
+        else
+        if (parent->count >= QBTREE_INNER_MIN)
+        {
+            break;
+        }
+
+        qbtree_inner *inner = parent;
+        --level;
+        parent = path[level];
+        idx    = path_idx[level];
+
+        qbtree_inner *less_inner    = idx > 0 ? parent->children[idx - 1] : NULL;
+        qbtree_inner *greater_inner = idx < parent->count ? parent->children[idx + 1] : NULL;
+        if (less_inner != NULL && less_inner->count > QBTREE_INNER_MIN)
+        {
+            // rotate the greatest key of the less sibling through the parent
+            inner->children[inner->count + 1] = inner->children[inner->count];
+            for (size_t move_idx = inner->count; move_idx > 0; --move_idx)
+            {
+                inner->keys[move_idx]     = inner->keys[move_idx - 1];
+                inner->children[move_idx] = inner->children[move_idx - 1];
+            }
+            inner->keys[0]     = parent->keys[idx - 1];
+            inner->children[0] = less_inner->children[less_inner->count];
+            ++(inner->count);
+            --(less_inner->count);
+            parent->keys[idx - 1] = less_inner->keys[less_inner->count];
+            break;
+        }
+        else
+        if (greater_inner != NULL && greater_inner->count > QBTREE_INNER_MIN)
+        {
+            // rotate the least key of the greater sibling through the parent
+            inner->keys[inner->count]         = parent->keys[idx];
+            inner->children[inner->count + 1] = greater_inner->children[0];
+            ++(inner->count);
+            parent->keys[idx] = greater_inner->keys[0];
+            --(greater_inner->count);
+            for (size_t move_idx = 0; move_idx < greater_inner->count; ++move_idx)
+            {
+                greater_inner->keys[move_idx]     = greater_inner->keys[move_idx + 1];
+                greater_inner->children[move_idx] = greater_inner->children[move_idx + 1];
+            }
+            greater_inner->children[greater_inner->count] =
+                greater_inner->children[greater_inner->count + 1];
+            break;
+        }
+        else
+        {
+            // merge the greater one of two adjacent inner nodes and the
+            // separating key into the less one
+            size_t key_idx = idx;
+            if (less_inner != NULL)
+            {
+                greater_inner = inner;
+                --key_idx;
+            }
+            else
+            {
+                less_inner = inner;
+            }
+            less_inner->keys[less_inner->count] = parent->keys[key_idx];
+            for (size_t move_idx = 0; move_idx < greater_inner->count; ++move_idx)
+            {
+                less_inner->keys[less_inner->count + 1 + move_idx] = greater_inner->keys[move_idx];
+            }
+            for (size_t move_idx = 0; move_idx <= greater_inner->count; ++move_idx)
+            {
+                less_inner->children[less_inner->count + 1 + move_idx] = greater_inner->children[move_idx];
+            }
+            less_inner->count += greater_inner->count + 1;
+            free(greater_inner);
+            qbtree_impl_inner_erase(parent, key_idx);
+        }
+    }
+}
+
+
+/**
+ * Removes a key and the child that follows the key from an inner node
+ */
+static inline void qbtree_impl_inner_erase(qbtree_inner *inner, const size_t key_idx)
+{
+    --(inner->count);
+    for (size_t move_idx = key_idx; move_idx < inner->count; ++move_idx)
+    {
+        inner->keys[move_idx]         = inner->keys[move_idx + 1];
+        inner->children[move_idx + 1] = inner->children[move_idx + 2];
+    }
+}
+
+
+static void qbtree_impl_free_subtree(void *node, const size_t height)
+{
+    if (height > 0)
+    {
+        qbtree_inner *inner = node;
+        for (size_t idx = 0; idx <= inner->count; ++idx)
+        {
+            qbtree_impl_free_subtree(inner->children[idx], height - 1);
+        }
+    }
+    free(node);
+}
+
+
+static inline void qbtree_impl_init(qbtree *qbtree_obj, const qbtree_cmp_func cmp_func_ptr)
+{
+    qbtree_obj->root       = NULL;
+    qbtree_obj->head       = NULL;
+    qbtree_obj->height     = 0;
+    qbtree_obj->size       = 0;
+    qbtree_obj->qbtree_cmp = cmp_func_ptr;
+}
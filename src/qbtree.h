@@ -0,0 +1,63 @@
+#ifndef QBTREE_H
+#define	QBTREE_H
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+typedef enum
+{
+    QBTREE_PASS       = 0,
+    QBTREE_ERR_NOMEM  = 1,
+    QBTREE_ERR_EXISTS = 2
+}
+qbtree_rc;
+
+typedef int (*qbtree_cmp_func)(const void *val_alpha, const void *val_bravo);
+
+typedef struct qbtree_s         qbtree;
+typedef struct qbtree_entry_s   qbtree_entry;
+typedef struct qbtree_leaf_s    qbtree_leaf;
+typedef struct qbtree_it_s      qbtree_it;
+
+struct qbtree_s
+{
+    void            *root;
+    qbtree_leaf     *head;
+    size_t          height;
+    size_t          size;
+    qbtree_cmp_func qbtree_cmp;
+};
+
+struct qbtree_entry_s
+{
+    const void  *key;
+    const void  *value;
+};
+
+struct qbtree_it_s
+{
+    qbtree_leaf *leaf;
+    size_t      index;
+};
+
+void            qbtree_dealloc(qbtree *qbtree_obj);
+void            qbtree_clear(qbtree *qbtree_obj);
+qbtree          *qbtree_alloc(qbtree_cmp_func cmp_func_ptr);
+void            qbtree_init(qbtree *qbtree_obj, qbtree_cmp_func cmp_func_ptr);
+qbtree_rc       qbtree_insert(
+    qbtree      *qbtree_obj,
+    const void  *key,
+    const void  *value
+);
+void            qbtree_remove(qbtree *qbtree_obj, const void *key);
+void            *qbtree_get(const qbtree *qbtree_obj, const void *key);
+qbtree_entry    *qbtree_get_entry(const qbtree *qbtree_obj, const void *key);
+qbtree_it       *qbtree_iterator(const qbtree *qbtree_obj);
+void            qbtree_iterator_init(const qbtree *qbtree_obj, qbtree_it *iter);
+void            qbtree_iterator_seek(const qbtree *qbtree_obj, qbtree_it *iter, const void *key);
+qbtree_entry    *qbtree_next(qbtree_it *iter);
+size_t          qbtree_get_size(const qbtree *qbtree_obj);
+
+#endif	/* QBTREE_H */
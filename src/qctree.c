@@ -0,0 +1,715 @@
+/**
+ * Compact balanced binary search tree with nodes stored in an array
+ *
+ * @version 2026-10-16_001
+ * @author  Robert Altnoeder (r.altnoeder@gmx.net)
+ *
+ * Copyright (C) 2026 Robert ALTNOEDER
+ *
+ * Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that
+ * the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "qctree.h"
+
+/**
+ * Node layout
+ *
+ * All nodes of a qctree are stored in a single array that grows by doubling.
+ * Nodes refer to each other by 32-bit array indices instead of pointers, and
+ * the parent index shares a 32-bit field with the balance of the node, which
+ * is stored in the two lowest bits. This reduces the size of a node to 32 bytes
+ * on 64-bit platforms, and there is no allocation overhead per node.
+ *
+ * Index 0 is the null index, the first node is stored at index 1. Entries are
+ * kept contiguous: when an entry is removed, the node at the end of the array
+ * is moved into the free slot. Therefore, pointers to nodes returned by
+ * qctree_get_node() or qctree_next() are only valid until the tree is modified.
+ */
+
+static const size_t QCTREE_MIN_CAPACITY = 32;
+
+static inline uint32_t    qctree_impl_find_node(const qctree *qctree_obj, const void *key);
+static inline void        qctree_impl_remove_node(qctree *qctree_obj, uint32_t rm_idx);
+static inline void        qctree_impl_rebalance_insert(
+    qctree      *qctree_obj,
+    uint32_t    sub_idx,
+    uint32_t    rot_idx
+);
+static inline void        qctree_impl_rebalance_remove(
+    qctree      *qctree_obj,
+    uint32_t    rot_idx,
+    bool        less_side
+);
+static inline uint32_t    qctree_impl_rotate_left(qctree *qctree_obj, uint32_t rot_idx);
+static inline uint32_t    qctree_impl_rotate_right(qctree *qctree_obj, uint32_t rot_idx);
+static inline void        qctree_impl_replace_child(
+    qctree      *qctree_obj,
+    uint32_t    parent_idx,
+    uint32_t    old_idx,
+    uint32_t    new_idx
+);
+static inline uint32_t    qctree_impl_successor(const qctree *qctree_obj, uint32_t idx);
+static inline uint32_t    qctree_impl_parent(const qctree_node *node);
+static inline int         qctree_impl_balance(const qctree_node *node);
+static inline void        qctree_impl_set_parent(qctree_node *node, uint32_t parent_idx);
+static inline void        qctree_impl_set_balance(qctree_node *node, int balance);
+static inline void        qctree_impl_init(qctree *qctree_obj, qtree_cmp_func cmp_func_ptr);
+
+
+qctree *qctree_alloc(const qtree_cmp_func cmp_func_ptr)
+{
+    qctree *qctree_obj = malloc(sizeof (qctree));
+    if (qctree_obj != NULL)
+    {
+        qctree_impl_init(qctree_obj, cmp_func_ptr);
+    }
+
+    return qctree_obj;
+}
+
+
+void qctree_dealloc(qctree *qctree_obj)
+{
+    if (qctree_obj != NULL)
+    {
+        free(qctree_obj->nodes);
+    }
+    free(qctree_obj);
+}
+
+
+void qctree_clear(qctree *qctree_obj)
+{
+    free(qctree_obj->nodes);
+    qctree_impl_init(qctree_obj, qctree_obj->qctree_cmp);
+}
+
+
+void qctree_init(qctree *qctree_obj, const qtree_cmp_func cmp_func_ptr)
+{
+    qctree_impl_init(qctree_obj, cmp_func_ptr);
+}
+
+
+/**
+ * Ensures that the tree can hold the specified number of entries without
+ * growing its node array
+ */
+qtree_rc qctree_reserve(qctree *qctree_obj, const size_t count)
+{
+    qtree_rc rc = QTREE_PASS;
+    if (count > qctree_obj->capacity)
+    {
+        if (count <= QCTREE_MAX_NODES)
+        {
+            size_t capacity = qctree_obj->capacity * 2;
+            if (capacity < QCTREE_MIN_CAPACITY)
+            {
+                capacity = QCTREE_MIN_CAPACITY;
+            }
+            if (capacity < count)
+            {
+                capacity = count;
+            }
+            if (capacity > QCTREE_MAX_NODES)
+            {
+                capacity = QCTREE_MAX_NODES;
+            }
+
+            // one additional slot for the null index
+            qctree_node *nodes = realloc(qctree_obj->nodes, (capacity + 1) * sizeof (qctree_node));
+            if (nodes != NULL)
+            {
+                qctree_obj->nodes    = nodes;
+                qctree_obj->capacity = capacity;
+            }
+            else
+            {
+                rc = QTREE_ERR_NOMEM;
+            }
+        }
+        else
+        {
+            rc = QTREE_ERR_NOMEM;
+        }
+    }
+
+    return rc;
+}
+
+
+qtree_rc qctree_insert(qctree *qctree_obj, const void *key, const void *value)
+{
+    qtree_rc rc = QTREE_PASS;
+
+    uint32_t parent_idx = 0;
+    bool     less_side  = false;
+    uint32_t idx        = qctree_obj->root;
+    while (idx != 0)
+    {
+        const qctree_node *node = &(qctree_obj->nodes[idx]);
+        const int cmp_rc = qctree_obj->qctree_cmp(key, node->key);
+        if (cmp_rc < 0)
+        {
+            parent_idx = idx;
+            less_side  = true;
+            idx        = node->less;
+        }
+        else
+        if (cmp_rc > 0)
+        {
+            parent_idx = idx;
+            less_side  = false;
+            idx        = node->greater;
+        }
+        else
+        {
+            rc = QTREE_ERR_EXISTS;
+            break;
+        }
+    }
+
+    if (rc == QTREE_PASS)
+    {
+        rc = qctree_reserve(qctree_obj, qctree_obj->size + 1);
+    }
+
+    if (rc == QTREE_PASS)
+    {
+        ++(qctree_obj->size);
+        const uint32_t ins_idx = (uint32_t) qctree_obj->size;
+        qctree_node *ins_node = &(qctree_obj->nodes[ins_idx]);
+        ins_node->key     = key;
+        ins_node->value   = value;
+        ins_node->less    = 0;
+        ins_node->greater = 0;
+        ins_node->parent_balance = 0;
+        qctree_impl_set_parent(ins_node, parent_idx);
+        qctree_impl_set_balance(ins_node, 0);
+
+        if (parent_idx == 0)
+        {
+            qctree_obj->root = ins_idx;
+        }
+        else
+        {
+            if (less_side)
+            {
+                qctree_obj->nodes[parent_idx].less = ins_idx;
+            }
+            else
+            {
+                qctree_obj->nodes[parent_idx].greater = ins_idx;
+            }
+            qctree_impl_rebalance_insert(qctree_obj, ins_idx, parent_idx);
+        }
+    }
+
+    return rc;
+}
+
+
+void qctree_remove(qctree *qctree_obj, const void *key)
+{
+    const uint32_t idx = qctree_impl_find_node(qctree_obj, key);
+    if (idx != 0)
+    {
+        qctree_impl_remove_node(qctree_obj, idx);
+    }
+}
+
+
+void *qctree_get(const qctree *qctree_obj, const void *key)
+{
+    const void *value = NULL;
+    const uint32_t idx = qctree_impl_find_node(qctree_obj, key);
+    if (idx != 0)
+    {
+        value = qctree_obj->nodes[idx].value;
+    }
+    return (void *) value;
+}
+
+
+/**
+ * @return the node with the specified key, which is valid until the tree is modified, or NULL
+ */
+qctree_node *qctree_get_node(const qctree *qctree_obj, const void *key)
+{
+    qctree_node *node = NULL;
+    const uint32_t idx = qctree_impl_find_node(qctree_obj, key);
+    if (idx != 0)
+    {
+        node = &(qctree_obj->nodes[idx]);
+    }
+    return node;
+}
+
+
+/**
+ * Initializes an iterator that returns the entries in ascending order of keys
+ *
+ * The iterator is invalidated by any modification of the tree.
+ */
+void qctree_iterator_init(const qctree *qctree_obj, qctree_it *iter)
+{
+    iter->qctree_obj = qctree_obj;
+    iter->next       = qctree_obj->root;
+    if (iter->next != 0)
+    {
+        while (qctree_obj->nodes[iter->next].less != 0)
+        {
+            iter->next = qctree_obj->nodes[iter->next].less;
+        }
+    }
+}
+
+
+qctree_node *qctree_next(qctree_it *iter)
+{
+    qctree_node *ret_node = NULL;
+    if (iter->next != 0)
+    {
+        ret_node   = &(iter->qctree_obj->nodes[iter->next]);
+        iter->next = qctree_impl_successor(iter->qctree_obj, iter->next);
+    }
+    return ret_node;
+}
+
+
+size_t qctree_get_size(const qctree *qctree_obj)
+{
+    return qctree_obj->size;
+}
+
+
+static inline uint32_t qctree_impl_find_node(const qctree *qctree_obj, const void *key)
+{
+    uint32_t idx = qctree_obj->root;
+    while (idx != 0)
+    {
+        const qctree_node *node = &(qctree_obj->nodes[idx]);
+        const int cmp_rc = qctree_obj->qctree_cmp(key, node->key);
+        if (cmp_rc < 0)
+        {
+            idx = node->less;
+        }
+        else
+        if (cmp_rc > 0)
+        {
+            idx = node->greater;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    return idx;
+}
+
+
+/**
+ * Removes a node and moves the last node of the array into the free slot
+ */
+static inline void qctree_impl_remove_node(qctree *qctree_obj, uint32_t rm_idx)
+{
+    qctree_node *nodes = qctree_obj->nodes;
+
+    qctree_node *rm_node = &(nodes[rm_idx]);
+    if (rm_node->less != 0 && rm_node->greater != 0)
+    {
+        // Move the entry of the replacement node into this node and remove the
+        // replacement node instead, which has at most one child
+        uint32_t rep_idx = 0;
+        if (qctree_impl_balance(rm_node) == -1)
+        {
+            rep_idx = rm_node->less;
+            while (nodes[rep_idx].greater != 0)
+            {
+                rep_idx = nodes[rep_idx].greater;
+            }
+        }
+        else
+        {
+            rep_idx = rm_node->greater;
+            while (nodes[rep_idx].less != 0)
+            {
+                rep_idx = nodes[rep_idx].less;
+            }
+        }
+        rm_node->key   = nodes[rep_idx].key;
+        rm_node->value = nodes[rep_idx].value;
+        rm_idx  = rep_idx;
+        rm_node = &(nodes[rm_idx]);
+    }
+
+    const uint32_t child_idx  = rm_node->less != 0 ? rm_node->less : rm_node->greater;
+    const uint32_t parent_idx = qctree_impl_parent(rm_node);
+    if (child_idx != 0)
+    {
+        qctree_impl_set_parent(&(nodes[child_idx]), parent_idx);
+    }
+    if (parent_idx == 0)
+    {
+        qctree_obj->root = child_idx;
+    }
+    else
+    {
+        const bool less_side = nodes[parent_idx].less == rm_idx;
+        qctree_impl_replace_child(qctree_obj, parent_idx, rm_idx, child_idx);
+        qctree_impl_rebalance_remove(qctree_obj, parent_idx, less_side);
+    }
+
+    const uint32_t last_idx = (uint32_t) qctree_obj->size;
+    --(qctree_obj->size);
+    if (rm_idx != last_idx)
+    {
+        nodes[rm_idx] = nodes[last_idx];
+        rm_node = &(nodes[rm_idx]);
+        qctree_impl_replace_child(qctree_obj, qctree_impl_parent(rm_node), last_idx, rm_idx);
+        if (rm_node->less != 0)
+        {
+            qctree_impl_set_parent(&(nodes[rm_node->less]), rm_idx);
+        }
+        if (rm_node->greater != 0)
+        {
+            qctree_impl_set_parent(&(nodes[rm_node->greater]), rm_idx);
+        }
+    }
+}
+
+
+/**
+ * Rebalances the tree after node insertion
+ *
+ * @param sub_idx index of the child of rot_idx whose subtree has grown
+ */
+static inline void qctree_impl_rebalance_insert(qctree *qctree_obj, uint32_t sub_idx, uint32_t rot_idx)
+{
+    qctree_node *nodes = qctree_obj->nodes;
+    do
+    {
+        qctree_node *rot_node = &(nodes[rot_idx]);
+        qctree_node *sub_node = &(nodes[sub_idx]);
+        const int balance = qctree_impl_balance(rot_node) + (rot_node->less == sub_idx ? -1 : 1);
+        if (balance == 0)
+        {
+            qctree_impl_set_balance(rot_node, 0);
+            break;
+        }
+        else
+        if (balance == -2)
+        {
+            if (qctree_impl_balance(sub_node) == -1)
+            {
+                // rotate R
+                qctree_impl_rotate_right(qctree_obj, rot_idx);
+                qctree_impl_set_balance(rot_node, 0);
+                qctree_impl_set_balance(sub_node, 0);
+            }
+            else
+            {
+                // rotate LR
+                qctree_node *pivot_node = &(nodes[sub_node->greater]);
+                const int pivot_balance = qctree_impl_balance(pivot_node);
+                qctree_impl_rotate_left(qctree_obj, sub_idx);
+                qctree_impl_rotate_right(qctree_obj, rot_idx);
+                qctree_impl_set_balance(sub_node, pivot_balance == 1 ? -1 : 0);
+                qctree_impl_set_balance(rot_node, pivot_balance == -1 ? 1 : 0);
+                qctree_impl_set_balance(pivot_node, 0);
+            }
+            break;
+        }
+        else
+        if (balance == 2)
+        {
+            if (qctree_impl_balance(sub_node) == 1)
+            {
+                // rotate L
+                qctree_impl_rotate_left(qctree_obj, rot_idx);
+                qctree_impl_set_balance(rot_node, 0);
+                qctree_impl_set_balance(sub_node, 0);
+            }
+            else
+            {
+                // rotate RL
+                qctree_node *pivot_node = &(nodes[sub_node->less]);
+                const int pivot_balance = qctree_impl_balance(pivot_node);
+                qctree_impl_rotate_right(qctree_obj, sub_idx);
+                qctree_impl_rotate_left(qctree_obj, rot_idx);
+                qctree_impl_set_balance(sub_node, pivot_balance == -1 ? 1 : 0);
+                qctree_impl_set_balance(rot_node, pivot_balance == 1 ? -1 : 0);
+                qctree_impl_set_balance(pivot_node, 0);
+            }
+            break;
+        }
+
+        qctree_impl_set_balance(rot_node, balance);
+        sub_idx = rot_idx;
+        rot_idx = qctree_impl_parent(rot_node);
+    }
+    while (rot_idx != 0);
+}
+
+
+/**
+ * Rebalances the tree after node removal
+ *
+ * @param less_side true if the subtree that has shrunk is the less subtree of rot_idx
+ */
+static inline void qctree_impl_rebalance_remove(qctree *qctree_obj, uint32_t rot_idx, bool less_side)
+{
+    qctree_node *nodes = qctree_obj->nodes;
+    while (rot_idx != 0)
+    {
+        qctree_node *rot_node = &(nodes[rot_idx]);
+        const int balance = qctree_impl_balance(rot_node) + (less_side ? 1 : -1);
+        // root of the subtree after rotations, whose height has decreased
+        uint32_t top_idx = rot_idx;
+        if (balance == -1 || balance == 1)
+        {
+            // height of the subtree is unchanged
+            qctree_impl_set_balance(rot_node, balance);
+            break;
+        }
+        else
+        if (balance == 0)
+        {
+            qctree_impl_set_balance(rot_node, 0);
+        }
+        else
+        if (balance == 2)
+        {
+            const uint32_t sub_idx = rot_node->greater;
+            qctree_node *sub_node = &(nodes[sub_idx]);
+            const int sub_balance = qctree_impl_balance(sub_node);
+            if (sub_balance >= 0)
+            {
+                // rotate L
+                qctree_impl_rotate_left(qctree_obj, rot_idx);
+                if (sub_balance == 0)
+                {
+                    qctree_impl_set_balance(rot_node, 1);
+                    qctree_impl_set_balance(sub_node, -1);
+                    break;
+                }
+                qctree_impl_set_balance(rot_node, 0);
+                qctree_impl_set_balance(sub_node, 0);
+                top_idx = sub_idx;
+            }
+            else
+            {
+                // rotate RL
+                top_idx = sub_node->less;
+                qctree_node *pivot_node = &(nodes[top_idx]);
+                const int pivot_balance = qctree_impl_balance(pivot_node);
+                qctree_impl_rotate_right(qctree_obj, sub_idx);
+                qctree_impl_rotate_left(qctree_obj, rot_idx);
+                qctree_impl_set_balance(sub_node, pivot_balance == -1 ? 1 : 0);
+                qctree_impl_set_balance(rot_node, pivot_balance == 1 ? -1 : 0);
+                qctree_impl_set_balance(pivot_node, 0);
+            }
+        }
+        else
+        {
+            const uint32_t sub_idx = rot_node->less;
+            qctree_node *sub_node = &(nodes[sub_idx]);
+            const int sub_balance = qctree_impl_balance(sub_node);
+            if (sub_balance <= 0)
+            {
+                // rotate R
+                qctree_impl_rotate_right(qctree_obj, rot_idx);
+                if (sub_balance == 0)
+                {
+                    qctree_impl_set_balance(rot_node, -1);
+                    qctree_impl_set_balance(sub_node, 1);
+                    break;
+                }
+                qctree_impl_set_balance(rot_node, 0);
+                qctree_impl_set_balance(sub_node, 0);
+                top_idx = sub_idx;
+            }
+            else
+            {
+                // rotate LR
+                top_idx = sub_node->greater;
+                qctree_node *pivot_node = &(nodes[top_idx]);
+                const int pivot_balance = qctree_impl_balance(pivot_node);
+                qctree_impl_rotate_left(qctree_obj, sub_idx);
+                qctree_impl_rotate_right(qctree_obj, rot_idx);
+                qctree_impl_set_balance(sub_node, pivot_balance == 1 ? -1 : 0);
+                qctree_impl_set_balance(rot_node, pivot_balance == -1 ? 1 : 0);
+                qctree_impl_set_balance(pivot_node, 0);
+            }
+        }
+
+        rot_idx = qctree_impl_parent(&(nodes[top_idx]));
+        if (rot_idx != 0)
+        {
+            less_side = nodes[rot_idx].less == top_idx;
+        }
+    }
+}
+
+
+/**
+ * @return index of the node that replaces rot_idx as the root of the subtree
+ */
+static inline uint32_t qctree_impl_rotate_left(qctree *qctree_obj, const uint32_t rot_idx)
+{
+    qctree_node *nodes = qctree_obj->nodes;
+    qctree_node *rot_node = &(nodes[rot_idx]);
+    const uint32_t sub_idx    = rot_node->greater;
+    const uint32_t parent_idx = qctree_impl_parent(rot_node);
+    qctree_node *sub_node = &(nodes[sub_idx]);
+
+    rot_node->greater = sub_node->less;
+    if (sub_node->less != 0)
+    {
+        qctree_impl_set_parent(&(nodes[sub_node->less]), rot_idx);
+    }
+    qctree_impl_set_parent(sub_node, parent_idx);
+    qctree_impl_replace_child(qctree_obj, parent_idx, rot_idx, sub_idx);
+    sub_node->less = rot_idx;
+    qctree_impl_set_parent(rot_node, sub_idx);
+
+    return sub_idx;
+}
+
+
+/**
+ * @return index of the node that replaces rot_idx as the root of the subtree
+ */
+static inline uint32_t qctree_impl_rotate_right(qctree *qctree_obj, const uint32_t rot_idx)
+{
+    qctree_node *nodes = qctree_obj->nodes;
+    qctree_node *rot_node = &(nodes[rot_idx]);
+    const uint32_t sub_idx    = rot_node->less;
+    const uint32_t parent_idx = qctree_impl_parent(rot_node);
+    qctree_node *sub_node = &(nodes[sub_idx]);
+
+    rot_node->less = sub_node->greater;
+    if (sub_node->greater != 0)
+    {
+        qctree_impl_set_parent(&(nodes[sub_node->greater]), rot_idx);
+    }
+    qctree_impl_set_parent(sub_node, parent_idx);
+    qctree_impl_replace_child(qctree_obj, parent_idx, rot_idx, sub_idx);
+    sub_node->greater = rot_idx;
+    qctree_impl_set_parent(rot_node, sub_idx);
+
+    return sub_idx;
+}
+
+
+/**
+ * Replaces the link from parent_idx, or from the root if parent_idx is the null index, to old_idx
+ */
+static inline void qctree_impl_replace_child(
+    qctree          *qctree_obj,
+    const uint32_t  parent_idx,
+    const uint32_t  old_idx,
+    const uint32_t  new_idx
+)
+{
+    if (parent_idx == 0)
+    {
+        qctree_obj->root = new_idx;
+    }
+    else
+    {
+        qctree_node *parent_node = &(qctree_obj->nodes[parent_idx]);
+        if (parent_node->less == old_idx)
+        {
+            parent_node->less = new_idx;
+        }
+        else
+        {
+            parent_node->greater = new_idx;
+        }
+    }
+}
+
+
+static inline uint32_t qctree_impl_successor(const qctree *qctree_obj, uint32_t idx)
+{
+    const qctree_node *nodes = qctree_obj->nodes;
+    if (nodes[idx].greater != 0)
+    {
+        idx = nodes[idx].greater;
+        while (nodes[idx].less != 0)
+        {
+            idx = nodes[idx].less;
+        }
+    }
+    else
+    {
+        uint32_t parent_idx = qctree_impl_parent(&(nodes[idx]));
+        while (parent_idx != 0 && nodes[parent_idx].greater == idx)
+        {
+            idx        = parent_idx;
+            parent_idx = qctree_impl_parent(&(nodes[idx]));
+        }
+        idx = parent_idx;
+    }
+
+    return idx;
+}
+
+
+static inline uint32_t qctree_impl_parent(const qctree_node *node)
+{
+    return node->parent_balance >> 2;
+}
+
+
+static inline int qctree_impl_balance(const qctree_node *node)
+{
+    return (int) (node->parent_balance & 3) - 1;
+}
+
+
+static inline void qctree_impl_set_parent(qctree_node *node, const uint32_t parent_idx)
+{
+    node->parent_balance = (parent_idx << 2) | (node->parent_balance & 3);
+}
+
+
+/**
+ * Stores the balance, which is in the range from -1 to 1, as an unsigned value in the two lowest bits
+ */
+static inline void qctree_impl_set_balance(qctree_node *node, const int balance)
+{
+    node->parent_balance = (node->parent_balance & ~((uint32_t) 3)) | (uint32_t) (balance + 1);
+}
+
+
+static inline void qctree_impl_init(qctree *qctree_obj, const qtree_cmp_func cmp_func_ptr)
+{
+    qctree_obj->nodes      = NULL;
+    qctree_obj->capacity   = 0;
+    qctree_obj->size       = 0;
+    qctree_obj->root       = 0;
+    qctree_obj->qctree_cmp = cmp_func_ptr;
+}
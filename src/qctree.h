@@ -0,0 +1,60 @@
+#ifndef QCTREE_H
+#define	QCTREE_H
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "qtree.h"
+
+// Maximum number of entries, the indices of nodes are stored in 30 bits
+#define QCTREE_MAX_NODES ((size_t) 0x3FFFFFFF)
+
+typedef struct qctree_s      qctree;
+typedef struct qctree_node_s qctree_node;
+typedef struct qctree_it_s   qctree_it;
+
+struct qctree_s
+{
+    qctree_node     *nodes;
+    size_t          capacity;
+    size_t          size;
+    uint32_t        root;
+    qtree_cmp_func  qctree_cmp;
+};
+
+struct qctree_node_s
+{
+    const void  *key;
+    const void  *value;
+    uint32_t    less;
+    uint32_t    greater;
+    uint32_t    parent_balance;
+};
+
+struct qctree_it_s
+{
+    const qctree    *qctree_obj;
+    uint32_t        next;
+};
+
+void        qctree_dealloc(qctree *qctree_obj);
+void        qctree_clear(qctree *qctree_obj);
+qctree      *qctree_alloc(qtree_cmp_func cmp_func_ptr);
+void        qctree_init(qctree *qctree_obj, qtree_cmp_func cmp_func_ptr);
+qtree_rc    qctree_reserve(qctree *qctree_obj, size_t count);
+qtree_rc    qctree_insert(
+    qctree      *qctree_obj,
+    const void  *key,
+    const void  *value
+);
+void        qctree_remove(qctree *qctree_obj, const void *key);
+void        *qctree_get(const qctree *qctree_obj, const void *key);
+qctree_node *qctree_get_node(const qctree *qctree_obj, const void *key);
+void        qctree_iterator_init(const qctree *qctree_obj, qctree_it *iter);
+qctree_node *qctree_next(qctree_it *iter);
+size_t      qctree_get_size(const qctree *qctree_obj);
+
+#endif	/* QCTREE_H */
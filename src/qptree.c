@@ -0,0 +1,677 @@
+/**
+ * Persistent balanced binary search tree with copy-on-write snapshots
+ *
+ * @version 2026-10-16_001
+ * @author  Robert Altnoeder (r.altnoeder@gmx.net)
+ *
+ * Copyright (C) 2026 Robert ALTNOEDER
+ *
+ * Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that
+ * the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "qptree.h"
+
+/**
+ * Versions and snapshots
+ *
+ * A qptree is an AVL tree without parent pointers, so that a subtree can be
+ * shared by multiple versions of the tree. Each node counts the references
+ * to it from parent nodes and from tree roots. A modification copies only the
+ * shared nodes that it changes, which are the nodes on the search path and,
+ * when removing, the siblings touched by rotations; nodes that are referenced
+ * only once are changed in place. Taking a snapshot adds a reference to the
+ * root, and a node is freed when its last reference is released.
+ *
+ * Reference counts are updated atomically, so that snapshots can be used and
+ * released by other threads while the tree is being modified. Modifying a tree
+ * and taking snapshots of it must be serialized by the caller. Keys and values
+ * are not copied and must stay valid as long as any version references them.
+ */
+
+static inline qptree_node *qptree_impl_find_node(const qptree *qptree_obj, const void *key);
+static inline size_t      qptree_impl_copy_count(
+    const qptree    *qptree_obj,
+    const void      *key,
+    bool            remove,
+    bool            *found
+);
+static inline qptree_rc   qptree_impl_alloc_pool(qptree_node **pool, size_t count);
+static inline void        qptree_impl_free_pool(qptree_node *pool);
+static qptree_node        *qptree_impl_insert(
+    qptree_node     *node,
+    qptree_cmp_func cmp_func_ptr,
+    const void      *key,
+    const void      *value,
+    qptree_node     **pool
+);
+static qptree_node        *qptree_impl_remove(
+    qptree_node     *node,
+    qptree_cmp_func cmp_func_ptr,
+    const void      *key,
+    qptree_node     **pool
+);
+static qptree_node        *qptree_impl_remove_min(
+    qptree_node *node,
+    qptree_node **min_node,
+    qptree_node **pool
+);
+static inline qptree_node *qptree_impl_own(qptree_node *node, qptree_node **pool);
+static inline qptree_node *qptree_impl_rebalance(qptree_node *node, qptree_node **pool);
+static inline qptree_node *qptree_impl_rotate_left(qptree_node *rot_node, qptree_node **pool);
+static inline qptree_node *qptree_impl_rotate_right(qptree_node *rot_node, qptree_node **pool);
+static inline int         qptree_impl_height(const qptree_node *node);
+static inline void        qptree_impl_update_height(qptree_node *node);
+static inline bool        qptree_impl_is_shared(qptree_node *node);
+static inline void        qptree_impl_retain(qptree_node *node);
+static void               qptree_impl_release(qptree_node *node);
+static inline void        qptree_impl_init(qptree *qptree_obj, qptree_cmp_func cmp_func_ptr);
+
+
+qptree *qptree_alloc(const qptree_cmp_func cmp_func_ptr)
+{
+    qptree *qptree_obj = malloc(sizeof (qptree));
+    if (qptree_obj != NULL)
+    {
+        qptree_impl_init(qptree_obj, cmp_func_ptr);
+    }
+
+    return qptree_obj;
+}
+
+
+void qptree_dealloc(qptree *qptree_obj)
+{
+    if (qptree_obj != NULL)
+    {
+        qptree_impl_release(qptree_obj->root);
+    }
+    free(qptree_obj);
+}
+
+
+/**
+ * Releases the version of the tree, nodes that are shared with other versions
+ * remain allocated
+ */
+void qptree_clear(qptree *qptree_obj)
+{
+    qptree_impl_release(qptree_obj->root);
+    qptree_obj->root = NULL;
+    qptree_obj->size = 0;
+}
+
+
+void qptree_init(qptree *qptree_obj, const qptree_cmp_func cmp_func_ptr)
+{
+    qptree_impl_init(qptree_obj, cmp_func_ptr);
+}
+
+
+/**
+ * Initializes snapshot as a frozen view of the current version of the tree
+ *
+ * Runs in O(1). Later modifications of either tree do not affect the other one.
+ * The snapshot is released by qptree_clear().
+ */
+void qptree_snapshot(const qptree *qptree_obj, qptree *snapshot)
+{
+    qptree_impl_retain(qptree_obj->root);
+    snapshot->root       = qptree_obj->root;
+    snapshot->size       = qptree_obj->size;
+    snapshot->qptree_cmp = qptree_obj->qptree_cmp;
+}
+
+
+qptree_rc qptree_insert(qptree *qptree_obj, const void *key, const void *value)
+{
+    bool found = false;
+    const size_t copy_count = qptree_impl_copy_count(qptree_obj, key, false, &found);
+
+    qptree_rc rc = QPTREE_ERR_EXISTS;
+    if (!found)
+    {
+        // All nodes that may be needed are allocated in advance, so that the
+        // insertion cannot fail after the tree has been modified
+        qptree_node *pool = NULL;
+        rc = qptree_impl_alloc_pool(&pool, copy_count + 1);
+        if (rc == QPTREE_PASS)
+        {
+            qptree_obj->root = qptree_impl_insert(qptree_obj->root, qptree_obj->qptree_cmp, key, value, &pool);
+            ++(qptree_obj->size);
+            qptree_impl_free_pool(pool);
+        }
+    }
+
+    return rc;
+}
+
+
+qptree_rc qptree_remove(qptree *qptree_obj, const void *key)
+{
+    bool found = false;
+    const size_t copy_count = qptree_impl_copy_count(qptree_obj, key, true, &found);
+
+    qptree_rc rc = QPTREE_PASS;
+    if (found)
+    {
+        qptree_node *pool = NULL;
+        rc = qptree_impl_alloc_pool(&pool, copy_count);
+        if (rc == QPTREE_PASS)
+        {
+            qptree_obj->root = qptree_impl_remove(qptree_obj->root, qptree_obj->qptree_cmp, key, &pool);
+            --(qptree_obj->size);
+            qptree_impl_free_pool(pool);
+        }
+    }
+
+    return rc;
+}
+
+
+void *qptree_get(const qptree *qptree_obj, const void *key)
+{
+    const void *value = NULL;
+    qptree_node *node = qptree_impl_find_node(qptree_obj, key);
+    if (node != NULL)
+    {
+        value = node->value;
+    }
+    return (void *) value;
+}
+
+
+qptree_node *qptree_get_node(const qptree *qptree_obj, const void *key)
+{
+    return qptree_impl_find_node(qptree_obj, key);
+}
+
+
+size_t qptree_get_size(const qptree *qptree_obj)
+{
+    return qptree_obj->size;
+}
+
+
+qptree_it *qptree_iterator(const qptree *qptree_obj)
+{
+    qptree_it *iter = malloc(sizeof (qptree_it));
+    if (iter != NULL)
+    {
+        qptree_iterator_init(qptree_obj, iter);
+    }
+    return iter;
+}
+
+
+void qptree_iterator_init(const qptree *qptree_obj, qptree_it *iter)
+{
+    iter->depth = 0;
+    qptree_node *node = qptree_obj->root;
+    while (node != NULL)
+    {
+        iter->stack[iter->depth] = node;
+        ++(iter->depth);
+        node = node->less;
+    }
+}
+
+
+/**
+ * Initializes an iterator that starts at the first key that is greater than
+ * or equal to the specified key
+ */
+void qptree_iterator_seek(const qptree *qptree_obj, qptree_it *iter, const void *key)
+{
+    iter->depth = 0;
+    qptree_node *node = qptree_obj->root;
+    while (node != NULL)
+    {
+        const int cmp_rc = qptree_obj->qptree_cmp(key, node->key);
+        if (cmp_rc <= 0)
+        {
+            iter->stack[iter->depth] = node;
+            ++(iter->depth);
+            node = cmp_rc < 0 ? node->less : NULL;
+        }
+        else
+        {
+            node = node->greater;
+        }
+    }
+}
+
+
+/**
+ * Returns the next node in ascending order of keys
+ *
+ * Modifying the tree invalidates the iterator, iterators on a snapshot remain
+ * valid until the snapshot is released.
+ */
+qptree_node *qptree_next(qptree_it *iter)
+{
+    qptree_node *next_node = NULL;
+    if (iter->depth > 0)
+    {
+        --(iter->depth);
+        next_node = iter->stack[iter->depth];
+
+        qptree_node *node = next_node->greater;
+        while (node != NULL)
+        {
+            iter->stack[iter->depth] = node;
+            ++(iter->depth);
+            node = node->less;
+        }
+    }
+    return next_node;
+}
+
+
+static inline qptree_node *qptree_impl_find_node(const qptree *qptree_obj, const void *key)
+{
+    qptree_node *node = qptree_obj->root;
+    while (node != NULL)
+    {
+        const int cmp_rc = qptree_obj->qptree_cmp(key, node->key);
+        if (cmp_rc < 0)
+        {
+            node = node->less;
+        }
+        else
+        if (cmp_rc > 0)
+        {
+            node = node->greater;
+        }
+        else
+        {
+            break;
+        }
+    }
+    return node;
+}
+
+
+/**
+ * @return upper bound for the number of nodes that an insertion or removal of
+ *         the specified key has to copy
+ *
+ * Below the first shared node on the search path, all nodes are shared. When
+ * removing, rebalancing may additionally copy a sibling of a node on the path
+ * and one of the sibling's children on each level.
+ */
+static inline size_t qptree_impl_copy_count(
+    const qptree    *qptree_obj,
+    const void      *key,
+    const bool      remove,
+    bool            *found
+)
+{
+    size_t copy_count = 0;
+    bool   shared     = false;
+
+    qptree_node *node = qptree_obj->root;
+    while (node != NULL)
+    {
+        shared = shared || qptree_impl_is_shared(node);
+        if (shared)
+        {
+            ++copy_count;
+        }
+
+        const int cmp_rc = *found ? -1 : qptree_obj->qptree_cmp(key, node->key);
+        if (cmp_rc == 0)
+        {
+            *found = true;
+        }
+
+        qptree_node *next_node = cmp_rc < 0 ? node->less : node->greater;
+        if (remove)
+        {
+            qptree_node *sibling = cmp_rc < 0 ? node->greater : node->less;
+            if (sibling != NULL)
+            {
+                const bool sibling_shared = shared || qptree_impl_is_shared(sibling);
+                if (sibling_shared ||
+                    (sibling->less != NULL && qptree_impl_is_shared(sibling->less)) ||
+                    (sibling->greater != NULL && qptree_impl_is_shared(sibling->greater)))
+                {
+                    ++copy_count;
+                }
+                if (sibling_shared)
+                {
+                    ++copy_count;
+                }
+            }
+        }
+        else
+        if (cmp_rc == 0)
+        {
+            next_node = NULL;
+        }
+        // When removing, continue along the path to the successor
+        node = next_node;
+    }
+
+    return copy_count;
+}
+
+
+static inline qptree_rc qptree_impl_alloc_pool(qptree_node **pool, size_t count)
+{
+    qptree_rc rc = QPTREE_PASS;
+    while (count > 0 && rc == QPTREE_PASS)
+    {
+        qptree_node *node = malloc(sizeof (qptree_node));
+        if (node != NULL)
+        {
+            node->less = *pool;
+            *pool = node;
+        }
+        else
+        {
+            qptree_impl_free_pool(*pool);
+            *pool = NULL;
+            rc = QPTREE_ERR_NOMEM;
+        }
+        --count;
+    }
+    return rc;
+}
+
+
+static inline void qptree_impl_free_pool(qptree_node *pool)
+{
+    while (pool != NULL)
+    {
+        qptree_node *next_node = pool->less;
+        free(pool);
+        pool = next_node;
+    }
+}
+
+
+/**
+ * Inserts an entry into the subtree
+ *
+ * Consumes the caller's reference to node and returns a reference to the
+ * resulting subtree. The key must not exist in the subtree.
+ */
+static qptree_node *qptree_impl_insert(
+    qptree_node             *node,
+    const qptree_cmp_func   cmp_func_ptr,
+    const void              *key,
+    const void              *value,
+    qptree_node             **pool
+)
+{
+    if (node != NULL)
+    {
+        node = qptree_impl_own(node, pool);
+        if (cmp_func_ptr(key, node->key) < 0)
+        {
+            node->less = qptree_impl_insert(node->less, cmp_func_ptr, key, value, pool);
+        }
+        else
+        {
+            node->greater = qptree_impl_insert(node->greater, cmp_func_ptr, key, value, pool);
+        }
+        node = qptree_impl_rebalance(node, pool);
+    }
+    else
+    {
+        node = *pool;
+        *pool = node->less;
+
+        node->key     = key;
+        node->value   = value;
+        node->less    = NULL;
+        node->greater = NULL;
+        node->height  = 1;
+        node->refs    = 1;
+    }
+    return node;
+}
+
+
+/**
+ * Removes the entry with the specified key from the subtree
+ *
+ * Consumes the caller's reference to node and returns a reference to the
+ * resulting subtree. The key must exist in the subtree.
+ */
+static qptree_node *qptree_impl_remove(
+    qptree_node             *node,
+    const qptree_cmp_func   cmp_func_ptr,
+    const void              *key,
+    qptree_node             **pool
+)
+{
+    const int cmp_rc = cmp_func_ptr(key, node->key);
+    if (cmp_rc != 0)
+    {
+        node = qptree_impl_own(node, pool);
+        if (cmp_rc < 0)
+        {
+            node->less = qptree_impl_remove(node->less, cmp_func_ptr, key, pool);
+        }
+        else
+        {
+            node->greater = qptree_impl_remove(node->greater, cmp_func_ptr, key, pool);
+        }
+        node = qptree_impl_rebalance(node, pool);
+    }
+    else
+    {
+        // A shared node is not modified, it is still part of other versions
+        qptree_node *less    = node->less;
+        qptree_node *greater = node->greater;
+        if (qptree_impl_is_shared(node))
+        {
+            qptree_impl_retain(less);
+            qptree_impl_retain(greater);
+            qptree_impl_release(node);
+        }
+        else
+        {
+            free(node);
+        }
+
+        if (less != NULL && greater != NULL)
+        {
+            greater = qptree_impl_remove_min(greater, &node, pool);
+            node->less    = less;
+            node->greater = greater;
+            node = qptree_impl_rebalance(node, pool);
+        }
+        else
+        {
+            node = less != NULL ? less : greater;
+        }
+    }
+    return node;
+}
+
+
+/**
+ * Detaches the node with the least key from the subtree
+ *
+ * Consumes the caller's reference to node and returns a reference to the
+ * resulting subtree. The detached node is owned by the caller.
+ */
+static qptree_node *qptree_impl_remove_min(
+    qptree_node *node,
+    qptree_node **min_node,
+    qptree_node **pool
+)
+{
+    node = qptree_impl_own(node, pool);
+    if (node->less != NULL)
+    {
+        node->less = qptree_impl_remove_min(node->less, min_node, pool);
+        node = qptree_impl_rebalance(node, pool);
+    }
+    else
+    {
+        *min_node = node;
+        node = node->greater;
+        (*min_node)->greater = NULL;
+    }
+    return node;
+}
+
+
+/**
+ * Returns a node that can be modified in place of the specified node
+ *
+ * Consumes the caller's reference to node. If the node is shared, it is
+ * replaced by a copy that shares the node's children.
+ */
+static inline qptree_node *qptree_impl_own(qptree_node *node, qptree_node **pool)
+{
+    if (qptree_impl_is_shared(node))
+    {
+        qptree_node *copy_node = *pool;
+        *pool = copy_node->less;
+
+        copy_node->key     = node->key;
+        copy_node->value   = node->value;
+        copy_node->less    = node->less;
+        copy_node->greater = node->greater;
+        copy_node->height  = node->height;
+        copy_node->refs    = 1;
+        qptree_impl_retain(copy_node->less);
+        qptree_impl_retain(copy_node->greater);
+
+        qptree_impl_release(node);
+        node = copy_node;
+    }
+    return node;
+}
+
+
+/**
+ * Restores the balance of an owned node whose subtrees differ in height by at most two
+ */
+static inline qptree_node *qptree_impl_rebalance(qptree_node *node, qptree_node **pool)
+{
+    const int balance = qptree_impl_height(node->greater) - qptree_impl_height(node->less);
+    if (balance > 1)
+    {
+        node->greater = qptree_impl_own(node->greater, pool);
+        if (qptree_impl_height(node->greater->less) > qptree_impl_height(node->greater->greater))
+        {
+            node->greater = qptree_impl_rotate_right(node->greater, pool);
+        }
+        node = qptree_impl_rotate_left(node, pool);
+    }
+    else
+    if (balance < -1)
+    {
+        node->less = qptree_impl_own(node->less, pool);
+        if (qptree_impl_height(node->less->greater) > qptree_impl_height(node->less->less))
+        {
+            node->less = qptree_impl_rotate_left(node->less, pool);
+        }
+        node = qptree_impl_rotate_right(node, pool);
+    }
+    else
+    {
+        qptree_impl_update_height(node);
+    }
+    return node;
+}
+
+
+static inline qptree_node *qptree_impl_rotate_left(qptree_node *rot_node, qptree_node **pool)
+{
+    qptree_node *sub_node = qptree_impl_own(rot_node->greater, pool);
+    rot_node->greater = sub_node->less;
+    sub_node->less    = rot_node;
+    qptree_impl_update_height(rot_node);
+    qptree_impl_update_height(sub_node);
+    return sub_node;
+}
+
+
+static inline qptree_node *qptree_impl_rotate_right(qptree_node *rot_node, qptree_node **pool)
+{
+    qptree_node *sub_node = qptree_impl_own(rot_node->less, pool);
+    rot_node->less    = sub_node->greater;
+    sub_node->greater = rot_node;
+    qptree_impl_update_height(rot_node);
+    qptree_impl_update_height(sub_node);
+    return sub_node;
+}
+
+
+static inline int qptree_impl_height(const qptree_node *node)
+{
+    return node != NULL ? node->height : 0;
+}
+
+
+static inline void qptree_impl_update_height(qptree_node *node)
+{
+    const int less_height    = qptree_impl_height(node->less);
+    const int greater_height = qptree_impl_height(node->greater);
+    node->height = (less_height > greater_height ? less_height : greater_height) + 1;
+}
+
+
+static inline bool qptree_impl_is_shared(qptree_node *node)
+{
+    return __atomic_load_n(&(node->refs), __ATOMIC_ACQUIRE) > 1;
+}
+
+
+static inline void qptree_impl_retain(qptree_node *node)
+{
+    if (node != NULL)
+    {
+        __atomic_add_fetch(&(node->refs), 1, __ATOMIC_RELAXED);
+    }
+}
+
+
+/**
+ * Releases a reference to the node, and frees the node and releases its
+ * children if it was the last reference
+ */
+static void qptree_impl_release(qptree_node *node)
+{
+    while (node != NULL && __atomic_sub_fetch(&(node->refs), 1, __ATOMIC_ACQ_REL) == 0)
+    {
+        qptree_node *greater = node->greater;
+        qptree_impl_release(node->less);
+        free(node);
+        node = greater;
+    }
+}
+
+
+static inline void qptree_impl_init(qptree *qptree_obj, const qptree_cmp_func cmp_func_ptr)
+{
+    qptree_obj->root       = NULL;
+    qptree_obj->size       = 0;
+    qptree_obj->qptree_cmp = cmp_func_ptr;
+}
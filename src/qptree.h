@@ -0,0 +1,68 @@
+#ifndef QPTREE_H
+#define	QPTREE_H
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+typedef enum
+{
+    QPTREE_PASS       = 0,
+    QPTREE_ERR_NOMEM  = 1,
+    QPTREE_ERR_EXISTS = 2
+}
+qptree_rc;
+
+// Sufficient for any number of entries that fits into a size_t
+#define QPTREE_MAX_HEIGHT 96
+
+typedef int (*qptree_cmp_func)(const void *val_alpha, const void *val_bravo);
+
+typedef struct qptree_s      qptree;
+typedef struct qptree_node_s qptree_node;
+typedef struct qptree_it_s   qptree_it;
+
+struct qptree_s
+{
+    qptree_node     *root;
+    size_t          size;
+    qptree_cmp_func qptree_cmp;
+};
+
+struct qptree_node_s
+{
+    const void  *key;
+    const void  *value;
+    qptree_node *less;
+    qptree_node *greater;
+    int         height;
+    size_t      refs;
+};
+
+struct qptree_it_s
+{
+    qptree_node *stack[QPTREE_MAX_HEIGHT];
+    size_t      depth;
+};
+
+void        qptree_dealloc(qptree *qptree_obj);
+void        qptree_clear(qptree *qptree_obj);
+qptree      *qptree_alloc(qptree_cmp_func cmp_func_ptr);
+void        qptree_init(qptree *qptree_obj, qptree_cmp_func cmp_func_ptr);
+void        qptree_snapshot(const qptree *qptree_obj, qptree *snapshot);
+qptree_rc   qptree_insert(
+    qptree      *qptree_obj,
+    const void  *key,
+    const void  *value
+);
+qptree_rc   qptree_remove(qptree *qptree_obj, const void *key);
+void        *qptree_get(const qptree *qptree_obj, const void *key);
+qptree_node *qptree_get_node(const qptree *qptree_obj, const void *key);
+qptree_it   *qptree_iterator(const qptree *qptree_obj);
+void        qptree_iterator_init(const qptree *qptree_obj, qptree_it *iter);
+void        qptree_iterator_seek(const qptree *qptree_obj, qptree_it *iter, const void *key);
+qptree_node *qptree_next(qptree_it *iter);
+size_t      qptree_get_size(const qptree *qptree_obj);
+
+#endif	/* QPTREE_H */
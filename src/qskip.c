@@ -0,0 +1,638 @@
+/**
+ * Lock-free concurrent ordered map (skip list)
+ *
+ * @version 2026-10-16_001
+ * @author  Robert Altnoeder (r.altnoeder@gmx.net)
+ *
+ * Copyright (C) 2026 Robert ALTNOEDER
+ *
+ * Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that
+ * the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "qskip.h"
+
+/**
+ * Lock-free skip list
+ *
+ * Entries are kept in a sorted linked list at level 0, and each entry is also
+ * linked into a random number of higher levels that let searches skip ahead.
+ * All links are changed by compare-and-swap, so no thread ever waits for
+ * another one. An entry is removed by setting the lowest bit of each of its
+ * links, top level first; setting the mark on the level 0 link is the point
+ * at which the removal takes effect. Marked entries are unlinked by the next
+ * search that passes them.
+ *
+ * Each thread uses its own qskip_thread handle. Removed entries may still be
+ * visited by other threads, so they are retired and freed by epoch-based
+ * reclamation once no thread can reference them anymore. An entry that is
+ * removed while its inserting thread is still linking its higher levels is
+ * retired by the inserting thread, which is the last one to link it.
+ */
+
+#define QSKIP_MARK              ((uintptr_t) 1)
+// Number of retired entries after which a thread attempts to advance the epoch
+#define QSKIP_RECLAIM_INTERVAL  64
+
+static const int QSKIP_STATE_LINKING = 0;
+static const int QSKIP_STATE_LINKED  = 1;
+static const int QSKIP_STATE_REMOVED = 2;
+
+static inline bool       qskip_impl_find(
+    qskip           *qskip_obj,
+    const void      *key,
+    uintptr_t       **preds,
+    qskip_node      **succs
+);
+static inline void       qskip_impl_link_levels(
+    qskip_thread    *thread,
+    qskip_node      *node,
+    uintptr_t       **preds,
+    qskip_node      **succs
+);
+static inline int        qskip_impl_random_level(qskip_thread *thread);
+static inline bool       qskip_impl_is_marked(uintptr_t link);
+static inline qskip_node *qskip_impl_link_node(uintptr_t link);
+static inline void       qskip_impl_enter(qskip_thread *thread);
+static inline void       qskip_impl_exit(qskip_thread *thread);
+static inline void       qskip_impl_retire(qskip_thread *thread, qskip_node *node);
+static inline void       qskip_impl_try_advance(qskip *qskip_obj);
+static inline void       qskip_impl_free_list(const qskip *qskip_obj, qskip_node *node);
+
+
+qskip *qskip_alloc(const qtree_cmp_func cmp_func_ptr, const qskip_free_func free_func_ptr)
+{
+    qskip *qskip_obj = malloc(sizeof (qskip));
+    if (qskip_obj != NULL)
+    {
+        for (size_t level = 0; level < QSKIP_MAX_LEVEL; ++level)
+        {
+            qskip_obj->head[level] = 0;
+        }
+        qskip_obj->epoch      = 1;
+        qskip_obj->threads    = NULL;
+        qskip_obj->qskip_cmp  = cmp_func_ptr;
+        qskip_obj->entry_free = free_func_ptr;
+    }
+
+    return qskip_obj;
+}
+
+
+/**
+ * Frees all entries and thread handles, no thread may be using the list
+ *
+ * The free function, if any, is called for every entry that is freed, including
+ * entries that were removed earlier and have not been freed yet.
+ */
+void qskip_dealloc(qskip *qskip_obj)
+{
+    if (qskip_obj != NULL)
+    {
+        qskip_node *node = qskip_impl_link_node(qskip_obj->head[0]);
+        while (node != NULL)
+        {
+            qskip_node *next_node = qskip_impl_link_node(node->next[0]);
+            if (qskip_obj->entry_free != NULL)
+            {
+                qskip_obj->entry_free(node->key, node->value);
+            }
+            free(node);
+            node = next_node;
+        }
+
+        qskip_thread *thread = qskip_obj->threads;
+        while (thread != NULL)
+        {
+            qskip_thread *next_thread = thread->next;
+            qskip_impl_free_list(qskip_obj, thread->limbo);
+            free(thread);
+            thread = next_thread;
+        }
+    }
+    free(qskip_obj);
+}
+
+
+/**
+ * Returns a handle for the calling thread
+ *
+ * Each thread that accesses the list needs its own handle. Handles are reused
+ * after they are released, and freed together with the list.
+ */
+qskip_thread *qskip_thread_alloc(qskip *qskip_obj)
+{
+    qskip_thread *thread = __atomic_load_n(&(qskip_obj->threads), __ATOMIC_ACQUIRE);
+    while (thread != NULL)
+    {
+        bool in_use = false;
+        if (__atomic_compare_exchange_n(&(thread->in_use), &in_use, true, false,
+            __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+        {
+            break;
+        }
+        thread = thread->next;
+    }
+
+    if (thread == NULL)
+    {
+        thread = malloc(sizeof (qskip_thread));
+        if (thread != NULL)
+        {
+            thread->epoch        = 0;
+            thread->in_use       = true;
+            thread->qskip_obj    = qskip_obj;
+            thread->nesting      = 0;
+            thread->local_epoch  = __atomic_load_n(&(qskip_obj->epoch), __ATOMIC_ACQUIRE);
+            thread->limbo        = NULL;
+            thread->retire_count = 0;
+            thread->size_add     = 0;
+            thread->size_sub     = 0;
+            thread->rnd_state    = (uint64_t) (uintptr_t) thread | 1;
+            thread->next         = __atomic_load_n(&(qskip_obj->threads), __ATOMIC_RELAXED);
+            while (!__atomic_compare_exchange_n(&(qskip_obj->threads), &(thread->next), thread, true,
+                __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+            {
+                // thread->next was updated by the failed exchange
+            }
+        }
+    }
+
+    return thread;
+}
+
+
+void qskip_thread_release(qskip_thread *thread)
+{
+    __atomic_store_n(&(thread->in_use), false, __ATOMIC_RELEASE);
+}
+
+
+qskip_rc qskip_insert(qskip_thread *thread, const void *key, const void *value)
+{
+    qskip_rc rc = QSKIP_PASS;
+    qskip *qskip_obj = thread->qskip_obj;
+
+    qskip_impl_enter(thread);
+
+    uintptr_t  *preds[QSKIP_MAX_LEVEL];
+    qskip_node *succs[QSKIP_MAX_LEVEL];
+    qskip_node *node = NULL;
+    bool linked = false;
+    while (!linked && rc == QSKIP_PASS)
+    {
+        if (qskip_impl_find(qskip_obj, key, preds, succs))
+        {
+            rc = QSKIP_ERR_EXISTS;
+        }
+        else
+        {
+            if (node == NULL)
+            {
+                const int level_count = qskip_impl_random_level(thread);
+                node = malloc(sizeof (qskip_node) + sizeof (uintptr_t) * (size_t) level_count);
+                if (node != NULL)
+                {
+                    node->key          = key;
+                    node->value        = value;
+                    node->retired      = NULL;
+                    node->retire_epoch = 0;
+                    node->state        = QSKIP_STATE_LINKING;
+                    node->level_count  = level_count;
+                }
+                else
+                {
+                    rc = QSKIP_ERR_NOMEM;
+                }
+            }
+            if (node != NULL)
+            {
+                for (int level = 0; level < node->level_count; ++level)
+                {
+                    node->next[level] = (uintptr_t) succs[level];
+                }
+                uintptr_t expected = (uintptr_t) succs[0];
+                linked = __atomic_compare_exchange_n(&(preds[0][0]), &expected, (uintptr_t) node, false,
+                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+            }
+        }
+    }
+
+    if (linked)
+    {
+        __atomic_store_n(&(thread->size_add), thread->size_add + 1, __ATOMIC_RELAXED);
+        qskip_impl_link_levels(thread, node, preds, succs);
+    }
+    else
+    {
+        // The entry was never visible to other threads
+        free(node);
+    }
+
+    qskip_impl_exit(thread);
+
+    return rc;
+}
+
+
+void qskip_remove(qskip_thread *thread, const void *key)
+{
+    qskip *qskip_obj = thread->qskip_obj;
+
+    qskip_impl_enter(thread);
+
+    uintptr_t  *preds[QSKIP_MAX_LEVEL];
+    qskip_node *succs[QSKIP_MAX_LEVEL];
+    if (qskip_impl_find(qskip_obj, key, preds, succs))
+    {
+        qskip_node *node = succs[0];
+        for (int level = node->level_count - 1; level > 0; --level)
+        {
+            uintptr_t link = __atomic_load_n(&(node->next[level]), __ATOMIC_ACQUIRE);
+            while (!qskip_impl_is_marked(link) &&
+                !__atomic_compare_exchange_n(&(node->next[level]), &link, link | QSKIP_MARK, false,
+                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            {
+                // link was updated by the failed exchange
+            }
+        }
+
+        // Only the thread that marks level 0 removes the entry
+        bool removed = false;
+        uintptr_t link = __atomic_load_n(&(node->next[0]), __ATOMIC_ACQUIRE);
+        while (!removed && !qskip_impl_is_marked(link))
+        {
+            removed = __atomic_compare_exchange_n(&(node->next[0]), &link, link | QSKIP_MARK, false,
+                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+        }
+
+        if (removed)
+        {
+            __atomic_store_n(&(thread->size_sub), thread->size_sub + 1, __ATOMIC_RELAXED);
+
+            int state = QSKIP_STATE_LINKING;
+            if (!__atomic_compare_exchange_n(&(node->state), &state, QSKIP_STATE_REMOVED, false,
+                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            {
+                // All levels are linked, unlink them before retiring the entry
+                qskip_impl_find(qskip_obj, key, preds, succs);
+                qskip_impl_retire(thread, node);
+            }
+        }
+    }
+
+    qskip_impl_exit(thread);
+}
+
+
+void *qskip_get(qskip_thread *thread, const void *key)
+{
+    const void *value = NULL;
+    qskip *qskip_obj = thread->qskip_obj;
+
+    qskip_impl_enter(thread);
+
+    // Searches skip marked entries without unlinking them, so lookups do not write
+    const uintptr_t *pred = qskip_obj->head;
+    bool found = false;
+    for (int level = QSKIP_MAX_LEVEL - 1; level >= 0 && !found; --level)
+    {
+        qskip_node *node = qskip_impl_link_node(__atomic_load_n(&(pred[level]), __ATOMIC_ACQUIRE));
+        while (node != NULL)
+        {
+            const uintptr_t link = __atomic_load_n(&(node->next[level]), __ATOMIC_ACQUIRE);
+            if (!qskip_impl_is_marked(link))
+            {
+                const int cmp_rc = qskip_obj->qskip_cmp(key, node->key);
+                if (cmp_rc > 0)
+                {
+                    pred = node->next;
+                }
+                else
+                {
+                    if (cmp_rc == 0 && !qskip_impl_is_marked(__atomic_load_n(&(node->next[0]), __ATOMIC_ACQUIRE)))
+                    {
+                        value = node->value;
+                        found = true;
+                    }
+                    break;
+                }
+            }
+            node = qskip_impl_link_node(link);
+        }
+    }
+
+    qskip_impl_exit(thread);
+
+    return (void *) value;
+}
+
+
+/**
+ * Initializes an iterator that returns the entries in ascending order of keys
+ *
+ * Entries that are inserted or removed concurrently may or may not be returned.
+ * Entries returned by the iterator remain valid until qskip_iterator_end() is
+ * called, which must be done before the thread handle is used for other
+ * operations that are expected to reclaim memory.
+ */
+void qskip_iterator_init(qskip_thread *thread, qskip_it *iter)
+{
+    qskip_impl_enter(thread);
+    iter->thread = thread;
+    iter->next   = __atomic_load_n(&(thread->qskip_obj->head[0]), __ATOMIC_ACQUIRE);
+}
+
+
+qskip_node *qskip_next(qskip_it *iter)
+{
+    qskip_node *node = qskip_impl_link_node(iter->next);
+    uintptr_t  link  = 0;
+    while (node != NULL)
+    {
+        link = __atomic_load_n(&(node->next[0]), __ATOMIC_ACQUIRE);
+        if (!qskip_impl_is_marked(link))
+        {
+            break;
+        }
+        node = qskip_impl_link_node(link);
+    }
+    iter->next = link;
+    return node;
+}
+
+
+void qskip_iterator_end(qskip_it *iter)
+{
+    qskip_impl_exit(iter->thread);
+}
+
+
+/**
+ * Returns the number of entries, which is approximate while the list is being modified
+ */
+size_t qskip_get_size(const qskip *qskip_obj)
+{
+    size_t size = 0;
+    const qskip_thread *thread = __atomic_load_n(&(qskip_obj->threads), __ATOMIC_ACQUIRE);
+    while (thread != NULL)
+    {
+        size += __atomic_load_n(&(thread->size_add), __ATOMIC_RELAXED);
+        size -= __atomic_load_n(&(thread->size_sub), __ATOMIC_RELAXED);
+        thread = thread->next;
+    }
+    return size;
+}
+
+
+/**
+ * Searches for the specified key, unlinking marked entries along the way
+ *
+ * Sets preds to the links of the last entry with a lesser key and succs to the
+ * first entry with an equal or greater key on each level.
+ *
+ * @return true if an entry with the specified key was found
+ */
+static inline bool qskip_impl_find(
+    qskip       *qskip_obj,
+    const void  *key,
+    uintptr_t   **preds,
+    qskip_node  **succs
+)
+{
+    bool retry = true;
+    while (retry)
+    {
+        retry = false;
+        uintptr_t *pred = qskip_obj->head;
+        for (int level = QSKIP_MAX_LEVEL - 1; level >= 0 && !retry; --level)
+        {
+            uintptr_t pred_link = __atomic_load_n(&(pred[level]), __ATOMIC_ACQUIRE);
+            qskip_node *node = qskip_impl_link_node(pred_link);
+            // A marked link means that pred was removed, restart from the head
+            retry = qskip_impl_is_marked(pred_link);
+            while (node != NULL && !retry)
+            {
+                uintptr_t link = __atomic_load_n(&(node->next[level]), __ATOMIC_ACQUIRE);
+                if (qskip_impl_is_marked(link))
+                {
+                    uintptr_t expected = (uintptr_t) node;
+                    retry = !__atomic_compare_exchange_n(&(pred[level]), &expected, link & ~QSKIP_MARK, false,
+                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+                    node = qskip_impl_link_node(link);
+                }
+                else
+                if (qskip_obj->qskip_cmp(key, node->key) > 0)
+                {
+                    pred = node->next;
+                    node = qskip_impl_link_node(link);
+                }
+                else
+                {
+                    break;
+                }
+            }
+            preds[level] = pred;
+            succs[level] = node;
+        }
+    }
+
+    return succs[0] != NULL && qskip_obj->qskip_cmp(key, succs[0]->key) == 0;
+}
+
+
+/**
+ * Links a new entry, which is already linked on level 0, into its higher levels
+ *
+ * Stops if the entry is removed meanwhile. If it was, the entry is retired here,
+ * because the removing thread cannot know when linking has stopped.
+ */
+static inline void qskip_impl_link_levels(
+    qskip_thread    *thread,
+    qskip_node      *node,
+    uintptr_t       **preds,
+    qskip_node      **succs
+)
+{
+    qskip *qskip_obj = thread->qskip_obj;
+
+    bool removed = false;
+    for (int level = 1; level < node->level_count && !removed; ++level)
+    {
+        bool linked = false;
+        while (!linked && !removed)
+        {
+            uintptr_t link = __atomic_load_n(&(node->next[level]), __ATOMIC_ACQUIRE);
+            removed = qskip_impl_is_marked(link);
+            if (!removed && link != (uintptr_t) succs[level])
+            {
+                removed = !__atomic_compare_exchange_n(&(node->next[level]), &link, (uintptr_t) succs[level], false,
+                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+            }
+            if (!removed)
+            {
+                uintptr_t expected = (uintptr_t) succs[level];
+                linked = __atomic_compare_exchange_n(&(preds[level][level]), &expected, (uintptr_t) node, false,
+                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+                if (!linked)
+                {
+                    qskip_impl_find(qskip_obj, node->key, preds, succs);
+                }
+            }
+        }
+    }
+
+    int state = QSKIP_STATE_LINKING;
+    if (!__atomic_compare_exchange_n(&(node->state), &state, QSKIP_STATE_LINKED, false,
+        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        // Removed while linking, unlink the levels that this thread linked
+        qskip_impl_find(qskip_obj, node->key, preds, succs);
+        qskip_impl_retire(thread, node);
+    }
+}
+
+
+/**
+ * @return number of levels of a new entry, with a probability of 1/2 for each additional level
+ */
+static inline int qskip_impl_random_level(qskip_thread *thread)
+{
+    uint64_t rnd = thread->rnd_state;
+    rnd ^= rnd << 13;
+    rnd ^= rnd >> 7;
+    rnd ^= rnd << 17;
+    thread->rnd_state = rnd;
+
+    int level_count = 1;
+    while (level_count < QSKIP_MAX_LEVEL && (rnd & 1) != 0)
+    {
+        ++level_count;
+        rnd >>= 1;
+    }
+    return level_count;
+}
+
+
+static inline bool qskip_impl_is_marked(const uintptr_t link)
+{
+    return (link & QSKIP_MARK) != 0;
+}
+
+
+static inline qskip_node *qskip_impl_link_node(const uintptr_t link)
+{
+    return (qskip_node *) (link & ~QSKIP_MARK);
+}
+
+
+/**
+ * Announces that the thread is accessing the list in the current epoch, and
+ * frees the entries that the thread retired at least two epochs earlier
+ */
+static inline void qskip_impl_enter(qskip_thread *thread)
+{
+    if (thread->nesting == 0)
+    {
+        const size_t epoch = __atomic_load_n(&(thread->qskip_obj->epoch), __ATOMIC_ACQUIRE);
+        __atomic_store_n(&(thread->epoch), (epoch << 1) | 1, __ATOMIC_SEQ_CST);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+        if (epoch != thread->local_epoch)
+        {
+            // The limbo list is ordered from the most recently retired entry to the oldest one
+            qskip_node **link = &(thread->limbo);
+            while (*link != NULL && (*link)->retire_epoch + 2 > epoch)
+            {
+                link = &((*link)->retired);
+            }
+            qskip_impl_free_list(thread->qskip_obj, *link);
+            *link = NULL;
+            thread->local_epoch = epoch;
+        }
+    }
+    ++(thread->nesting);
+}
+
+
+static inline void qskip_impl_exit(qskip_thread *thread)
+{
+    --(thread->nesting);
+    if (thread->nesting == 0)
+    {
+        __atomic_store_n(&(thread->epoch), 0, __ATOMIC_RELEASE);
+    }
+}
+
+
+static inline void qskip_impl_retire(qskip_thread *thread, qskip_node *node)
+{
+    // Threads that announce a later epoch started after the entry was unlinked
+    node->retire_epoch = __atomic_load_n(&(thread->qskip_obj->epoch), __ATOMIC_SEQ_CST);
+    node->retired      = thread->limbo;
+    thread->limbo      = node;
+
+    ++(thread->retire_count);
+    if (thread->retire_count % QSKIP_RECLAIM_INTERVAL == 0)
+    {
+        qskip_impl_try_advance(thread->qskip_obj);
+    }
+}
+
+
+/**
+ * Advances the epoch if all active threads have announced the current epoch
+ */
+static inline void qskip_impl_try_advance(qskip *qskip_obj)
+{
+    size_t epoch = __atomic_load_n(&(qskip_obj->epoch), __ATOMIC_SEQ_CST);
+
+    bool current = true;
+    const qskip_thread *thread = __atomic_load_n(&(qskip_obj->threads), __ATOMIC_ACQUIRE);
+    while (thread != NULL && current)
+    {
+        const size_t thread_epoch = __atomic_load_n(&(thread->epoch), __ATOMIC_SEQ_CST);
+        current = thread_epoch == 0 || (thread_epoch >> 1) == epoch;
+        thread = thread->next;
+    }
+
+    if (current)
+    {
+        __atomic_compare_exchange_n(&(qskip_obj->epoch), &epoch, epoch + 1, false,
+            __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+    }
+}
+
+
+static inline void qskip_impl_free_list(const qskip *qskip_obj, qskip_node *node)
+{
+    while (node != NULL)
+    {
+        qskip_node *next_node = node->retired;
+        if (qskip_obj->entry_free != NULL)
+        {
+            qskip_obj->entry_free(node->key, node->value);
+        }
+        free(node);
+        node = next_node;
+    }
+}
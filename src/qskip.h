@@ -0,0 +1,88 @@
+#ifndef QSKIP_H
+#define	QSKIP_H
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "qtree.h"
+
+typedef enum
+{
+    QSKIP_PASS       = 0,
+    QSKIP_ERR_NOMEM  = 1,
+    QSKIP_ERR_EXISTS = 2
+}
+qskip_rc;
+
+#define QSKIP_MAX_LEVEL     32
+#define QSKIP_CACHE_LINE    64
+
+typedef void (*qskip_free_func)(const void *key, const void *value);
+
+typedef struct qskip_s          qskip;
+typedef struct qskip_node_s     qskip_node;
+typedef struct qskip_thread_s   qskip_thread;
+typedef struct qskip_it_s       qskip_it;
+
+struct qskip_s
+{
+    uintptr_t       head[QSKIP_MAX_LEVEL];
+    size_t          epoch;
+    qskip_thread    *threads;
+    qtree_cmp_func  qskip_cmp;
+    qskip_free_func entry_free;
+};
+
+struct qskip_node_s
+{
+    const void  *key;
+    const void  *value;
+    qskip_node  *retired;
+    size_t      retire_epoch;
+    int         state;
+    int         level_count;
+    uintptr_t   next[];
+};
+
+struct qskip_thread_s
+{
+    size_t          epoch;
+    bool            in_use;
+    qskip_thread    *next;
+    qskip           *qskip_obj;
+    size_t          nesting;
+    size_t          local_epoch;
+    qskip_node      *limbo;
+    size_t          retire_count;
+    size_t          size_add;
+    size_t          size_sub;
+    uint64_t        rnd_state;
+    unsigned char   padding[QSKIP_CACHE_LINE];
+};
+
+struct qskip_it_s
+{
+    qskip_thread    *thread;
+    uintptr_t       next;
+};
+
+qskip           *qskip_alloc(qtree_cmp_func cmp_func_ptr, qskip_free_func free_func_ptr);
+void            qskip_dealloc(qskip *qskip_obj);
+qskip_thread    *qskip_thread_alloc(qskip *qskip_obj);
+void            qskip_thread_release(qskip_thread *thread);
+qskip_rc        qskip_insert(
+    qskip_thread    *thread,
+    const void      *key,
+    const void      *value
+);
+void            qskip_remove(qskip_thread *thread, const void *key);
+void            *qskip_get(qskip_thread *thread, const void *key);
+void            qskip_iterator_init(qskip_thread *thread, qskip_it *iter);
+qskip_node      *qskip_next(qskip_it *iter);
+void            qskip_iterator_end(qskip_it *iter);
+size_t          qskip_get_size(const qskip *qskip_obj);
+
+#endif	/* QSKIP_H */
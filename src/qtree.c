@@ -29,6 +29,9 @@
  * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
+#include <pthread.h>
+#include <string.h>
+
 #include "qtree.h"
 
 typedef enum
@@ -38,9 +41,176 @@ typedef enum
 }
 qtree_dir;
 
+typedef enum
+{
+    QTREE_SET_UNION        = 0,
+    QTREE_SET_INTERSECTION = 1,
+    QTREE_SET_DIFFERENCE   = 2
+}
+qtree_set_op;
+
+typedef struct qtree_set_task_s qtree_set_task;
+typedef struct qtree_visit_task_s qtree_visit_task;
+typedef struct qtree_links_s qtree_links;
+
+// Threaded in-order links that follow each node in QTREE_OPT_THREADED mode
+struct qtree_links_s
+{
+    qtree_node  *next;
+    qtree_node  *prev;
+};
+
+// Subtrees of a set operation that are processed by the same thread
+struct qtree_set_task_s
+{
+    qtree           *qtree_obj;
+    qtree_set_op    set_op;
+    qtree_node      *dst_root;
+    int             dst_height;
+    qtree_node      *src_root;
+    int             src_height;
+    size_t          thread_count;
+    qtree_node      *drop_head;
+    qtree_node      *drop_tail;
+    size_t          drop_count;
+};
+
+// Subtree of a traversal and the contexts of the partitions it is divided into
+struct qtree_visit_task_s
+{
+    qtree_node          *lead_node;
+    qtree_node          *sub_root;
+    int                 sub_height;
+    qtree_visit_func    visitor;
+    void                **contexts;
+    size_t              part_count;
+};
+
+// Minimum subtree height for handing a part of a set operation or traversal to another thread
+#define QTREE_PARALLEL_MIN_HEIGHT 10
+
+// Options that maintain data about the subtree of each node
+#define QTREE_AUGMENT_OPTIONS ((unsigned int) (QTREE_OPT_ORDER_STATS | QTREE_OPT_INTERVAL | QTREE_OPT_AGGREGATE))
+
+// Sufficient for the height of any AVL tree with a number of nodes that fits into a size_t
+#define QTREE_MAX_HEIGHT 96
+
+// Number of lookups advanced in lockstep by qtree_get_batch()
+#define QTREE_BATCH_LANES 16
+
+#if defined(__GNUC__)
+#define QTREE_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define QTREE_PREFETCH(addr)
+#endif
+
+// Stores a link that the lock-free readers of qtree_conc may load concurrently
+// in QTREE_OPT_CONCURRENT mode. The release order makes the linked node's
+// fields visible before the link. Other fields that readers may load are
+// stored atomically, but without ordering.
+#if defined(__GNUC__)
+#define QTREE_STORE_LINK(qtree_obj, ref, node) \
+    (((qtree_obj)->options & QTREE_OPT_CONCURRENT) != 0 ? \
+        __atomic_store_n(&(ref), (node), __ATOMIC_RELEASE) : (void) ((ref) = (node)))
+#define QTREE_STORE_FIELD(qtree_obj, ref, val) \
+    (((qtree_obj)->options & QTREE_OPT_CONCURRENT) != 0 ? \
+        __atomic_store_n(&(ref), (val), __ATOMIC_RELAXED) : (void) ((ref) = (val)))
+#else
+#define QTREE_STORE_LINK(qtree_obj, ref, node) ((void) ((ref) = (node)))
+#define QTREE_STORE_FIELD(qtree_obj, ref, val) ((void) ((ref) = (val)))
+#endif
+
+// Fields that follow a node for the options of its tree. Each field is only
+// present if the tree uses the corresponding option or prefix function, so the
+// fields must not be accessed otherwise.
+#define QTREE_NODE_EXT(node, offset, type) (*(type *) ((char *) (node) + (offset)))
+#define QTREE_PREFIX(qtree_obj, node)    QTREE_NODE_EXT(node, (qtree_obj)->prefix_offset, uint64_t)
+#define QTREE_COUNT(qtree_obj, node)     QTREE_NODE_EXT(node, (qtree_obj)->count_offset, size_t)
+#define QTREE_MAX_END(qtree_obj, node)   QTREE_NODE_EXT(node, (qtree_obj)->end_offset, const void *)
+#define QTREE_AGGREGATE(qtree_obj, node) QTREE_NODE_EXT(node, (qtree_obj)->aggr_offset, qtree_aggr)
+#define QTREE_LINKS(links_offset, node)  QTREE_NODE_EXT(node, links_offset, qtree_links)
+
+// Node capacity of the first slab and upper limit for slab growth in arena mode
+static const size_t QTREE_SLAB_MIN_NODES = 32;
+static const size_t QTREE_SLAB_MAX_NODES = 16384;
+
+// Nodes of a slab are node_size bytes apart, as determined by the options of the tree
+struct qtree_slab_s
+{
+    qtree_slab  *next;
+    size_t      capacity;
+    qtree_node  nodes[];
+};
+
+// Number of counters in each block of a filter, a block occupies one cache line
+#define QTREE_FILTER_BLOCK_SIZE 64
+
+// Number of counters per entry of the capacity a filter is sized for
+static const size_t QTREE_FILTER_ENTRY_COUNTERS = 16;
+
+// Counters that reach the maximum value stick to it, because the number of
+// entries that share such a counter is not known anymore
+static const uint8_t QTREE_FILTER_COUNTER_MAX = 0xFF;
+
+// Counting Bloom filter, each key maps to four counters within a single block.
+// A stale filter is not consulted or updated until it is rebuilt.
+struct qtree_filter_s
+{
+    qtree_hash_func qtree_hash;
+    size_t          block_mask;
+    bool            stale;
+    uint8_t         *counters;
+    uint8_t         memory[];
+};
 
 static inline qtree_node *qtree_impl_find_node(const qtree *qtree_obj, const void *key);
+static inline qtree_node *qtree_impl_search_node(const qtree *qtree_obj, const void *key, bool use_prefix);
+static inline uint64_t   qtree_impl_prefix(const qtree *qtree_obj, const void *key);
+static inline void       qtree_impl_store_prefix(const qtree *qtree_obj, qtree_node *node, uint64_t prefix);
+static inline int        qtree_impl_cmp(
+    const qtree         *qtree_obj,
+    const void          *key,
+    uint64_t            key_prefix,
+    const qtree_node    *node,
+    bool                use_prefix
+);
+static inline qtree_node *qtree_impl_find_bound(
+    const qtree *qtree_obj,
+    const void  *key,
+    qtree_dir   dir,
+    bool        inclusive
+);
+static inline qtree_node *qtree_impl_search_bound(
+    const qtree *qtree_obj,
+    const void  *key,
+    qtree_dir   dir,
+    bool        inclusive,
+    bool        use_prefix
+);
+static inline qtree_node **qtree_impl_search_slot(
+    const qtree *qtree_obj,
+    qtree_node  *start_node,
+    const void  *key,
+    uint64_t    key_prefix,
+    qtree_node  **parent_out,
+    bool        use_prefix
+);
+static inline qtree_node *qtree_impl_successor(qtree_node *node);
+static inline qtree_node *qtree_impl_predecessor(qtree_node *node);
+static inline qtree_rc   qtree_impl_insert(
+    qtree       *qtree_obj,
+    qtree_node  *start_node,
+    const void  *key_ptr,
+    const void  *value_ptr,
+    qtree_node  **ins_node_out
+);
 static inline qtree_rc   qtree_impl_insert_node(qtree *qtree_obj, qtree_node *ins_node);
+static inline void       qtree_impl_link_leaf(
+    qtree       *qtree_obj,
+    qtree_node  *ins_node,
+    qtree_node  *parent_node,
+    qtree_node  **ref_ins_node
+);
 static inline void       qtree_impl_remove_node(qtree *qtree_obj, qtree_node *rm_node);
 static inline void       qtree_impl_unlink_node(qtree *qtree_obj, qtree_node *rm_node);
 static inline void       qtree_impl_rebalance_insert(
@@ -53,17 +223,170 @@ static inline void       qtree_impl_rebalance_remove(
     qtree_dir  dir,
     qtree_node *rot_node
 );
-static inline void       qtree_impl_init(qtree *qtree_obj, const qtree_cmp_func cmp_func_ptr);
+static inline qtree_rc   qtree_impl_alloc_sorted(
+    qtree       *qtree_obj,
+    const void  *keys[],
+    const void  *values[],
+    size_t      count,
+    qtree_node  **node_list
+);
+static int               qtree_impl_link_sorted(
+    const qtree         *qtree_obj,
+    qtree_node  *const *node_list,
+    size_t      count,
+    qtree_node  *parent_node,
+    qtree_node  **ref_sub_root
+);
+static inline void       qtree_impl_thread_node(
+    const qtree *qtree_obj,
+    qtree_node  *ins_node,
+    qtree_node  *parent_node,
+    bool        less_side
+);
+static inline void       qtree_impl_thread_list(
+    const qtree         *qtree_obj,
+    qtree_node  *const  *node_list,
+    size_t              count
+);
+static inline void       qtree_impl_thread_tree(const qtree *qtree_obj);
+static inline qtree_rc   qtree_impl_rebuild_balanced(qtree *qtree_obj);
+static inline uint8_t    *qtree_impl_filter_block(const qtree_filter *filter, const void *key, uint64_t *hash);
+static inline void       qtree_impl_filter_add(const qtree *qtree_obj, const void *key);
+static inline void       qtree_impl_filter_remove(const qtree *qtree_obj, const void *key);
+static inline bool       qtree_impl_filter_contains(const qtree *qtree_obj, const void *key);
+static inline void       qtree_impl_filter_add_subtree(const qtree *qtree_obj, const qtree_node *sub_root);
+static inline void       qtree_impl_filter_reset(const qtree *qtree_obj);
+static inline void       qtree_impl_filter_invalidate(const qtree *qtree_obj);
+static inline qtree_rc   qtree_impl_relocate(qtree *qtree_obj);
+static inline qtree_node *qtree_impl_copy_subtree(
+    const qtree *qtree_obj,
+    qtree_slab  *slab,
+    qtree_node  *sub_root,
+    qtree       *owner_obj
+);
+static inline void       qtree_impl_insert_bounds(
+    qtree       *qtree_obj,
+    qtree_node  *ins_node,
+    qtree_node  *parent_node,
+    bool        less_side
+);
+static inline void       qtree_impl_update_bounds(qtree *qtree_obj);
+static inline void       qtree_impl_update_node(const qtree *qtree_obj, qtree_node *node);
+static void              qtree_impl_overlaps(
+    const qtree         *qtree_obj,
+    qtree_node          *node,
+    const void          *low,
+    const void          *high,
+    qtree_visit_func    visitor,
+    void                *context
+);
+static inline void       qtree_impl_update_path(const qtree *qtree_obj, qtree_node *node);
+static inline size_t     qtree_impl_count(const qtree *qtree_obj, const qtree_node *node);
+static inline qtree_aggr qtree_impl_aggregate(const qtree *qtree_obj, const qtree_node *node);
+static inline size_t     qtree_impl_rank(const qtree *qtree_obj, const void *key, bool inclusive);
+static inline size_t     qtree_impl_search_rank(
+    const qtree *qtree_obj,
+    const void  *key,
+    bool        inclusive,
+    bool        use_prefix
+);
+static inline int        qtree_impl_height(const qtree_node *node);
+static inline int        qtree_impl_less_height(const qtree_node *node, int height);
+static inline int        qtree_impl_greater_height(const qtree_node *node, int height);
+static inline qtree_node *qtree_impl_rotate_left(const qtree *qtree_obj, qtree_node *rot_node);
+static inline qtree_node *qtree_impl_rotate_right(const qtree *qtree_obj, qtree_node *rot_node);
+static qtree_node        *qtree_impl_join(
+    const qtree *qtree_obj,
+    qtree_node  *less_root,
+    int         less_height,
+    qtree_node  *join_node,
+    qtree_node  *greater_root,
+    int         greater_height,
+    int         *join_height
+);
+static qtree_node        *qtree_impl_join2(
+    const qtree *qtree_obj,
+    qtree_node  *less_root,
+    int         less_height,
+    qtree_node  *greater_root,
+    int         greater_height,
+    int         *join_height
+);
+static qtree_node        *qtree_impl_split(
+    const qtree *qtree_obj,
+    qtree_node  *root,
+    int         height,
+    const void  *key,
+    qtree_node  **less_root,
+    int         *less_height,
+    qtree_node  **greater_root,
+    int         *greater_height
+);
+static inline size_t     qtree_impl_count_less(
+    qtree_node      *less_root,
+    qtree_node      *greater_root,
+    size_t          total
+);
+static inline bool       qtree_impl_same_layout(const qtree *qtree_obj, const qtree *other_obj);
+static inline void       qtree_impl_merge_arena(qtree *dst, qtree *src);
+static void              qtree_impl_set_op(qtree_set_task *task);
+static void              *qtree_impl_set_op_thread(void *task);
+static inline qtree_rc   qtree_impl_set_run(
+    qtree               *dst,
+    qtree               *src,
+    qtree_set_op        set_op,
+    size_t              thread_count,
+    qtree_visit_func    visitor,
+    void                *context
+);
+static inline void       qtree_impl_set_drop(qtree_set_task *task, qtree_node *node);
+static inline void       qtree_impl_set_drop_subtree(qtree_set_task *task, qtree_node *node);
+static inline void       qtree_impl_set_merge_drops(qtree_set_task *task, qtree_set_task *sub_task);
+static inline size_t     qtree_impl_free_subtree(
+    qtree               *qtree_obj,
+    qtree_node          *sub_root,
+    qtree_visit_func    visitor,
+    void                *context
+);
+static inline void       qtree_impl_visit_subtree(
+    qtree_node          *sub_root,
+    qtree_visit_func    visitor,
+    void                *context
+);
+static void              qtree_impl_visit_parallel(qtree_visit_task *task);
+static size_t            qtree_impl_visit_part_count(
+    const qtree_node    *sub_root,
+    int                 sub_height,
+    size_t              part_count
+);
+static void              *qtree_impl_visit_thread(void *task);
+static inline qtree_node *qtree_impl_alloc_node(qtree *qtree_obj);
+static inline qtree_node *qtree_impl_slab_node(const qtree *qtree_obj, qtree_slab *slab, size_t idx);
+static inline void       qtree_impl_free_node(qtree *qtree_obj, qtree_node *node);
+static inline void       qtree_impl_init_like(qtree *qtree_obj, const qtree *model_obj);
+static inline void       qtree_impl_release_empty(qtree *qtree_obj);
+static inline void       qtree_impl_init_layout(qtree *qtree_obj);
+static inline void       qtree_impl_init(
+    qtree                   *qtree_obj,
+    const qtree_cmp_func    cmp_func_ptr,
+    unsigned int            options
+);
 static inline void       qtree_impl_iterator_init(const qtree *qtree_obj, qtree_it *iter);
 static inline void       qtree_impl_clear(qtree *qtree_obj);
 
 
 qtree *qtree_alloc(const qtree_cmp_func cmp_func_ptr)
+{
+    return qtree_alloc_opt(cmp_func_ptr, QTREE_OPT_NONE);
+}
+
+
+qtree *qtree_alloc_opt(const qtree_cmp_func cmp_func_ptr, const unsigned int options)
 {
     qtree *qtree_obj = malloc(sizeof (qtree));
     if (qtree_obj != NULL)
     {
-        qtree_impl_init(qtree_obj, cmp_func_ptr);
+        qtree_impl_init(qtree_obj, cmp_func_ptr, options);
     }
 
     return qtree_obj;
@@ -72,433 +395,2075 @@ qtree *qtree_alloc(const qtree_cmp_func cmp_func_ptr)
 
 void qtree_dealloc(qtree *qtree_obj)
 {
-    qtree_impl_clear(qtree_obj);
-    free(qtree_obj);
+    if (qtree_obj != NULL)
+    {
+        qtree_impl_clear(qtree_obj);
+        free(qtree_obj->filter);
+        free(qtree_obj);
+    }
 }
 
 
+/**
+ * Removes all entries
+ *
+ * A filter attached to the tree remains attached and is reset.
+ */
 void qtree_clear(qtree *qtree_obj)
 {
     qtree_impl_clear(qtree_obj);
-    qtree_obj->size = 0;
-    qtree_obj->root = NULL;
+    qtree_impl_filter_reset(qtree_obj);
+    qtree_obj->size     = 0;
+    qtree_obj->root     = NULL;
+    qtree_obj->min_node = NULL;
+    qtree_obj->max_node = NULL;
 }
 
 
 void qtree_init(qtree *qtree_obj, const qtree_cmp_func cmp_func_ptr)
 {
-    qtree_impl_init(qtree_obj, cmp_func_ptr);
+    qtree_impl_init(qtree_obj, cmp_func_ptr, QTREE_OPT_NONE);
 }
 
 
-qtree_rc qtree_insert(qtree *qtree_obj, const void *key_ptr, const void *value_ptr)
+void qtree_init_opt(qtree *qtree_obj, const qtree_cmp_func cmp_func_ptr, const unsigned int options)
 {
-    qtree_rc rc = QTREE_PASS;
+    qtree_impl_init(qtree_obj, cmp_func_ptr, options);
+}
 
-    qtree_node **ref_ins_node = NULL;
-    qtree_node *parent_node = NULL;
 
-    if (qtree_obj->root == NULL)
-    {
-        ref_ins_node = &qtree_obj->root;
-    }
-    else
-    {
-        parent_node = qtree_obj->root;
-        while (true)
-        {
-            const int cmp_rc = qtree_obj->qtree_cmp(key_ptr, parent_node->key);
-            if (cmp_rc < 0)
-            {
-                if (parent_node->less == NULL)
-                {
-                    ref_ins_node = &parent_node->less;
-                    break;
-                }
-                else
-                {
-                    parent_node = parent_node->less;
-                }
-            }
-            else
-            if (cmp_rc > 0)
-            {
-                if (parent_node->greater == NULL)
-                {
-                    ref_ins_node = &parent_node->greater;
-                    break;
-                }
-                else
-                {
-                    parent_node = parent_node->greater;
-                }
-            }
-            else
-            {
-                rc = QTREE_ERR_EXISTS;
-                break;
-            }
-        }
-    }
+/**
+ * Initializes a tree that allocates its nodes from slabs
+ *
+ * Removed nodes are kept on a free list for reuse, and clearing or deallocating
+ * the tree releases all slabs at once instead of freeing each node.
+ * Nodes added using qtree_insert_node() remain owned by the caller and must be
+ * removed using qtree_unlink_node() instead of qtree_remove_node().
+ */
+void qtree_init_arena(qtree *qtree_obj, const qtree_cmp_func cmp_func_ptr)
+{
+    qtree_impl_init(qtree_obj, cmp_func_ptr, QTREE_OPT_ARENA);
+}
 
-    if (ref_ins_node != NULL)
-    {
-        qtree_node *ins_node = malloc(sizeof (qtree_node));
-        if (ins_node != NULL)
-        {
-            *ref_ins_node     = ins_node;
-            ins_node->key     = key_ptr;
-            ins_node->value   = value_ptr;
-            ins_node->parent  = parent_node;
-            ins_node->less    = NULL;
-            ins_node->greater = NULL;
-            ins_node->balance = 0;
-            ++(qtree_obj->size);
-            if (parent_node != NULL)
-            {
-                qtree_impl_rebalance_insert(qtree_obj, ins_node, parent_node);
-            }
-        }
-        else
-        {
-            rc = QTREE_ERR_NOMEM;
-        }
-    }
 
-    return rc;
+/**
+ * Initializes a tree of intervals that supports overlap queries
+ *
+ * The key of each entry is the start of an interval, and end_func_ptr returns
+ * the end of the interval of an entry. Interval ends are compared to each other
+ * and to keys by the comparator, and both bounds of an interval are inclusive.
+ * Each node keeps the greatest end of the intervals in its subtree.
+ */
+void qtree_init_interval(
+    qtree                   *qtree_obj,
+    const qtree_cmp_func    cmp_func_ptr,
+    const qtree_end_func    end_func_ptr,
+    const unsigned int      options
+)
+{
+    qtree_impl_init(qtree_obj, cmp_func_ptr, options | QTREE_OPT_INTERVAL);
+    qtree_obj->qtree_end = end_func_ptr;
 }
 
 
-qtree_rc qtree_insert_node(qtree *qtree_obj, qtree_node *node)
+/**
+ * Initializes a tree that keeps an aggregate of the entries of each subtree
+ *
+ * map_func_ptr maps an entry to its contribution to the aggregate, and
+ * combine_func_ptr combines the aggregates of two adjacent ranges of keys,
+ * with the range of lesser keys as the first argument. combine_func_ptr must be
+ * associative, and identity must be its identity element. Examples are the sum,
+ * minimum or maximum of counters stored in the values.
+ */
+void qtree_init_aggregate(
+    qtree                           *qtree_obj,
+    const qtree_cmp_func            cmp_func_ptr,
+    const qtree_aggr_map_func       map_func_ptr,
+    const qtree_aggr_combine_func   combine_func_ptr,
+    const qtree_aggr                identity,
+    const unsigned int              options
+)
 {
-    return qtree_impl_insert_node(qtree_obj, node);
+    qtree_impl_init(qtree_obj, cmp_func_ptr, options | QTREE_OPT_AGGREGATE);
+    qtree_obj->aggr_map      = map_func_ptr;
+    qtree_obj->aggr_combine  = combine_func_ptr;
+    qtree_obj->aggr_identity = identity;
 }
 
 
-void qtree_remove(qtree *qtree_obj, const void *key_ptr)
+/**
+ * Sets a function that maps each key to a prefix that is stored in the key's node
+ *
+ * Searches compare the prefixes first and call the comparator only if the
+ * prefixes are equal, which avoids dereferencing the keys of most nodes on
+ * the search path. The prefix function must be consistent with the comparator:
+ * if the comparator orders a key before another key, the prefix of the first
+ * key must not be greater than the prefix of the second key.
+ * Must be called while the tree is empty, because the prefix is stored in an
+ * additional field of each node, see qtree_node_size(); otherwise, the tree is
+ * not modified and QTREE_ERR_UNSUPPORTED is returned. Trees that are combined
+ * by set operations or joined must use the same prefix function.
+ */
+qtree_rc qtree_set_prefix_func(qtree *qtree_obj, const qtree_prefix_func prefix_func_ptr)
 {
-    qtree_node *node = qtree_impl_find_node(qtree_obj, key_ptr);
-    if (node != NULL)
+    qtree_rc rc = QTREE_PASS;
+
+    if (qtree_obj->size == 0)
     {
-        qtree_impl_remove_node(qtree_obj, node);
+        // The nodes that an arena keeps for reuse have the size of the previous layout
+        qtree_impl_clear(qtree_obj);
+        qtree_obj->qtree_prefix = prefix_func_ptr;
+        qtree_impl_init_layout(qtree_obj);
+    }
+    else
+    {
+        rc = QTREE_ERR_UNSUPPORTED;
     }
+
+    return rc;
 }
 
 
-void qtree_remove_node(qtree *qtree_obj, qtree_node *node)
+/**
+ * Prefix function for null-terminated string keys that are compared by strcmp()
+ *
+ * @return the first 8 characters of the string as a big-endian number, padded with zero bytes
+ */
+uint64_t qtree_string_prefix(const void *key)
 {
-    qtree_impl_remove_node(qtree_obj, node);
+    const unsigned char *str = key;
+    uint64_t prefix = 0;
+    size_t idx = 0;
+    while (idx < sizeof (prefix) && str[idx] != '\0')
+    {
+        prefix |= (uint64_t) str[idx] << (8 * (sizeof (prefix) - 1 - idx));
+        ++idx;
+    }
+    return prefix;
 }
 
 
-void qtree_unlink_node(qtree *qtree_obj, qtree_node *node)
+/**
+ * Attaches a counting Bloom filter that rejects most lookups of absent keys
+ * before searching the tree
+ *
+ * The filter is sized for the specified number of entries, or for the current
+ * number of entries if that is greater, and each lookup of an absent key reads
+ * a single cache line of the filter. If the tree holds more entries than the
+ * filter was sized for, the filter remains correct, but rejects fewer absent keys.
+ * The hash function should distribute keys uniformly over all 64 bits. It is
+ * called for the key of each entry that is inserted or removed, so the key of
+ * an entry must not be freed before the entry has been removed.
+ * Any filter that was attached before is released; if hash_func_ptr is NULL,
+ * no new filter is attached. A filter that is attached to a tree that is not
+ * deallocated using qtree_dealloc() must be released by calling this function
+ * with a NULL hash_func_ptr.
+ * Splitting, joining or uniting trees with a filter only marks the filter as
+ * stale instead of updating it in time linear in the number of moved entries,
+ * see qtree_rebuild_filter().
+ */
+qtree_rc qtree_set_filter(qtree *qtree_obj, const qtree_hash_func hash_func_ptr, size_t capacity)
 {
-    qtree_impl_unlink_node(qtree_obj, node);
-}
+    qtree_rc rc = QTREE_PASS;
 
+    free(qtree_obj->filter);
+    qtree_obj->filter = NULL;
 
-void *qtree_get(const qtree *qtree_obj, const void *key_ptr)
-{
-    const void *value = NULL;
-    qtree_node *node  = qtree_impl_find_node(qtree_obj, key_ptr);
-    if (node != NULL)
+    if (hash_func_ptr != NULL)
     {
-        value = node->value;
+        if (capacity < qtree_obj->size)
+        {
+            capacity = qtree_obj->size;
+        }
+        size_t block_count = 1;
+        while (block_count * QTREE_FILTER_BLOCK_SIZE < capacity * QTREE_FILTER_ENTRY_COUNTERS &&
+            block_count <= ((size_t) ~0) / (2 * QTREE_FILTER_BLOCK_SIZE))
+        {
+            block_count <<= 1;
+        }
+
+        // The counters are aligned to the size of a block
+        const size_t counters_size = block_count * QTREE_FILTER_BLOCK_SIZE;
+        qtree_filter *filter = NULL;
+        if (counters_size <= ((size_t) ~0) - sizeof (qtree_filter) - QTREE_FILTER_BLOCK_SIZE)
+        {
+            filter = malloc(sizeof (qtree_filter) + counters_size + QTREE_FILTER_BLOCK_SIZE - 1);
+        }
+        if (filter != NULL)
+        {
+            const uintptr_t align_mask = QTREE_FILTER_BLOCK_SIZE - 1;
+            filter->qtree_hash = hash_func_ptr;
+            filter->block_mask = block_count - 1;
+            filter->stale      = false;
+            filter->counters   = (uint8_t *) (((uintptr_t) filter->memory + align_mask) & ~align_mask);
+            for (size_t idx = 0; idx < counters_size; ++idx)
+            {
+                filter->counters[idx] = 0;
+            }
+            qtree_obj->filter = filter;
+            qtree_impl_filter_add_subtree(qtree_obj, qtree_obj->root);
+        }
+        else
+        {
+            rc = QTREE_ERR_NOMEM;
+        }
     }
-    return (void *) value;
+
+    return rc;
 }
 
 
-qtree_node *qtree_get_node(const qtree *qtree_obj, const void *key)
+/**
+ * Rebuilds a stale filter from the keys of all entries in O(n)
+ *
+ * qtree_split(), qtree_join() and qtree_union() mark the filters of the trees
+ * they modify as stale. A stale filter does not reject any key and is not
+ * updated by insertions and removals until it is rebuilt.
+ */
+void qtree_rebuild_filter(qtree *qtree_obj)
 {
-    return qtree_impl_find_node(qtree_obj, key);
+    if (qtree_obj->filter != NULL && qtree_obj->filter->stale)
+    {
+        qtree_impl_filter_reset(qtree_obj);
+        qtree_impl_filter_add_subtree(qtree_obj, qtree_obj->root);
+    }
 }
 
 
-size_t qtree_get_size(const qtree *qtree_obj)
+qtree_rc qtree_insert(qtree *qtree_obj, const void *key_ptr, const void *value_ptr)
 {
-    return qtree_obj->size;
+    return qtree_impl_insert(qtree_obj, qtree_obj->root, key_ptr, value_ptr, NULL);
 }
 
 
-qtree_it *qtree_iterator(const qtree *qtree_obj)
+/**
+ * Inserts an entry using a node that is allocated by the caller
+ *
+ * The node must provide qtree_node_size() bytes for the fields that the
+ * options of the tree append to the qtree_node structure. The caller sets the
+ * node's key and value, all other fields are initialized by the tree.
+ */
+qtree_rc qtree_insert_node(qtree *qtree_obj, qtree_node *node)
 {
-    qtree_it *iter = malloc(sizeof (qtree_it));
-    if (iter != NULL)
-    {
-        qtree_impl_iterator_init(qtree_obj, iter);
-    }
-    return iter;
+    return qtree_impl_insert_node(qtree_obj, node);
 }
 
 
-void qtree_iterator_init(const qtree *qtree_obj, qtree_it *iter)
+/**
+ * @return size of each node of the tree, including the fields for the options
+ *         and the prefix function of the tree
+ */
+size_t qtree_node_size(const qtree *qtree_obj)
 {
-    qtree_impl_iterator_init(qtree_obj, iter);
+    return qtree_obj->node_size;
 }
 
 
-qtree_node *qtree_next(qtree_it *iter)
+/**
+ * Inserts an entry by searching for its position starting at the hint node
+ *
+ * If the key is adjacent to the hint node, it is inserted next to the hint node
+ * without searching. Otherwise, the search ascends from the hint node's neighbor
+ * only as far as required to reach a subtree that contains the key's position and
+ * descends from there. Loading a nearly sorted sequence of keys therefore compares
+ * only O(1) keys per entry in the amortized case.
+ * If *hint is NULL, the search starts at the root.
+ * On return, *hint is updated to the inserted node, or to the node of the existing
+ * entry if the key is a duplicate, for use with the next insertion.
+ */
+qtree_rc qtree_insert_hint(
+    qtree       *qtree_obj,
+    qtree_node  **hint,
+    const void  *key_ptr,
+    const void  *value_ptr
+)
 {
-    qtree_node *ret_node = iter->next;
-
-    if (ret_node != NULL)
+    qtree_node *start_node = qtree_obj->root;
+    if (*hint != NULL)
     {
-        qtree_node *next_node = ret_node;
-        if (next_node->greater != NULL)
+        const uint64_t key_prefix = qtree_impl_prefix(qtree_obj, key_ptr);
+        const bool use_prefix = qtree_obj->qtree_prefix != NULL;
+        const bool threaded = (qtree_obj->options & QTREE_OPT_THREADED) != 0;
+        const size_t links_offset = qtree_obj->links_offset;
+        start_node = *hint;
+        const int hint_cmp_rc = qtree_impl_cmp(qtree_obj, key_ptr, key_prefix, start_node, use_prefix);
+        if (hint_cmp_rc != 0)
         {
-            next_node = next_node->greater;
-            while (next_node->less != NULL)
+            // If the key is between the hint node and its neighbor, the position is
+            // a free child slot of one of the two nodes
+            qtree_node *near_node = NULL;
+            if (hint_cmp_rc > 0)
             {
-                next_node = next_node->less;
+                near_node = threaded ? QTREE_LINKS(links_offset, start_node).next : qtree_impl_successor(start_node);
             }
-        }
-        else
-        {
-            do
+            else
+            {
+                near_node = threaded ? QTREE_LINKS(links_offset, start_node).prev : qtree_impl_predecessor(start_node);
+            }
+            const int near_cmp_rc = near_node != NULL ?
+                qtree_impl_cmp(qtree_obj, key_ptr, key_prefix, near_node, use_prefix) : -hint_cmp_rc;
+            if ((hint_cmp_rc > 0 && near_cmp_rc < 0) || (hint_cmp_rc < 0 && near_cmp_rc > 0))
+            {
+                qtree_node *hint_child = hint_cmp_rc > 0 ? start_node->greater : start_node->less;
+                if (hint_child != NULL)
+                {
+                    start_node = near_node;
+                }
+            }
+            else
+            if (near_cmp_rc == 0)
             {
-                if (next_node->parent != NULL)
+                start_node = near_node;
+            }
+            else
+            {
+                // Ascend from the neighbor until the key is within the range of keys
+                // covered by the subtree of start_node; ascending along the path on the
+                // side of the key does not change the bound on that side and does not
+                // require comparing any keys
+                start_node = near_node;
+                while (start_node->parent != NULL)
                 {
-                    if (next_node->parent->less == next_node)
+                    qtree_node *parent_node = start_node->parent;
+                    const bool toward_key = hint_cmp_rc > 0 ?
+                        parent_node->less == start_node :
+                        parent_node->greater == start_node;
+                    if (toward_key)
                     {
-                        next_node = next_node->parent;
-                        break;
+                        const int cmp_rc = qtree_impl_cmp(qtree_obj, key_ptr, key_prefix, parent_node, use_prefix);
+                        if ((hint_cmp_rc > 0 && cmp_rc < 0) || (hint_cmp_rc < 0 && cmp_rc > 0))
+                        {
+                            break;
+                        }
                     }
+                    start_node = parent_node;
                 }
-                next_node = next_node->parent;
             }
-            while (next_node != NULL);
         }
-        iter->next = next_node;
     }
-
-    return ret_node;
+    return qtree_impl_insert(qtree_obj, start_node, key_ptr, value_ptr, hint);
 }
 
 
 /**
- * Rebalances the tree after node removal
+ * Loads entries that are sorted in strictly ascending order of their keys
  *
- * WARNING! The order of statements, especially assignments, in this function
- *          is critical for the function's correct operation.
- *          DO NOT CHANGE THE ORDER OF ANY STATEMENTS.
+ * If the tree is empty, a balanced tree is built in O(n) without comparing any keys.
+ * Otherwise, the entries are merged into the tree as by qtree_insert_sorted().
+ * If values is NULL, the value of each entry is NULL.
  */
-static inline void qtree_impl_rebalance_remove(
+qtree_rc qtree_build_sorted(
     qtree       *qtree_obj,
-    qtree_dir   dir,
-    qtree_node  *rot_node
+    const void  *keys[],
+    const void  *values[],
+    const size_t count
 )
 {
-    // update balance and perform rotations
-    while (rot_node != NULL)
+    qtree_rc rc = QTREE_PASS;
+
+    if (qtree_obj->root != NULL)
     {
-        if (dir == QTREE_DIR_LESS)
+        rc = qtree_insert_sorted(qtree_obj, keys, values, count);
+    }
+    else
+    if (count > 0)
+    {
+        qtree_node **node_list = NULL;
+        if (count <= ((size_t) ~0) / sizeof (qtree_node *))
         {
-            // node was removed from left subtree
-            ++rot_node->balance;
-            if (rot_node->balance == 1)
+            node_list = malloc(count * sizeof (qtree_node *));
+        }
+        if (node_list != NULL)
+        {
+            rc = qtree_impl_alloc_sorted(qtree_obj, keys, values, count, node_list);
+            if (rc == QTREE_PASS)
             {
-                break;
+                qtree_impl_link_sorted(qtree_obj, node_list, count, NULL, &qtree_obj->root);
+                qtree_impl_thread_list(qtree_obj, node_list, count);
+                qtree_impl_filter_add_subtree(qtree_obj, qtree_obj->root);
+                qtree_obj->min_node = node_list[0];
+                qtree_obj->max_node = node_list[count - 1];
+                qtree_obj->size = count;
             }
+            free(node_list);
         }
         else
         {
-            // node was removed from right subtree
-            --rot_node->balance;
-            if (rot_node->balance == -1)
-            {
-                break;
-            }
+            rc = QTREE_ERR_NOMEM;
         }
+    }
 
-        if (rot_node->parent != NULL)
+    return rc;
+}
+
+
+/**
+ * Inserts entries that are sorted in strictly ascending order of their keys
+ *
+ * Unless the batch is small compared to the tree, the batch is merged with the
+ * entries of the tree in a single pass and the tree is rebuilt in O(n + m).
+ * Entries with a key that is already present are not inserted, and
+ * QTREE_ERR_EXISTS is returned after all other entries have been inserted.
+ * If values is NULL, the value of each entry is NULL.
+ */
+qtree_rc qtree_insert_sorted(
+    qtree       *qtree_obj,
+    const void  *keys[],
+    const void  *values[],
+    const size_t count
+)
+{
+    qtree_rc rc = QTREE_PASS;
+
+    size_t depth = 0;
+    for (size_t sub_size = qtree_obj->size; sub_size > 0; sub_size >>= 1)
+    {
+        ++depth;
+    }
+
+    if (qtree_obj->root == NULL)
+    {
+        rc = qtree_build_sorted(qtree_obj, keys, values, count);
+    }
+    else
+    if (count < qtree_obj->size / depth)
+    {
+        // Small batch, inserting each entry is cheaper than rebuilding the tree
+        for (size_t idx = 0; idx < count && rc != QTREE_ERR_NOMEM; ++idx)
         {
-            if (rot_node->parent->less == rot_node)
-            {
-                dir = QTREE_DIR_LESS;
-            }
-            else
+            const qtree_rc ins_rc = qtree_insert(
+                qtree_obj, keys[idx], values != NULL ? values[idx] : NULL
+            );
+            if (ins_rc != QTREE_PASS)
             {
-                dir = QTREE_DIR_GREATER;
+                rc = ins_rc;
             }
         }
-
-        // update balance and perform rotations
-        if (rot_node->balance == -2)
+    }
+    else
+    {
+        const size_t total = qtree_obj->size + count;
+        qtree_node **node_list = NULL;
+        if (total >= count && total <= ((size_t) ~0) / sizeof (qtree_node *))
         {
-            qtree_node *sub_node = rot_node->less;
-            // 0 or -1
-            if (sub_node->balance <= 0)
+            node_list = malloc(total * sizeof (qtree_node *));
+        }
+        if (node_list != NULL)
+        {
+            // The new nodes are placed at the end of the list, the merge
+            // never overwrites a new node before it has been consumed
+            qtree_node **batch_list = &(node_list[qtree_obj->size]);
+            rc = qtree_impl_alloc_sorted(qtree_obj, keys, values, count, batch_list);
+            if (rc == QTREE_PASS)
             {
-                // rotate R
-                sub_node->parent = rot_node->parent;
-                if (rot_node->parent != NULL)
+                qtree_it iter;
+                qtree_impl_iterator_init(qtree_obj, &iter);
+                qtree_node *crt_node = qtree_next(&iter);
+                const bool use_prefix = qtree_obj->qtree_prefix != NULL;
+
+                size_t merge_idx = 0;
+                size_t batch_idx = 0;
+                while (batch_idx < count)
                 {
-                    if (rot_node->parent->less == rot_node)
+                    qtree_node *ins_node = batch_list[batch_idx];
+                    const uint64_t ins_prefix = use_prefix ? QTREE_PREFIX(qtree_obj, ins_node) : 0;
+                    const int cmp_rc = crt_node != NULL ?
+                        qtree_impl_cmp(qtree_obj, ins_node->key, ins_prefix, crt_node, use_prefix) : -1;
+                    if (cmp_rc < 0)
                     {
-                        rot_node->parent->less = sub_node;
+                        node_list[merge_idx] = ins_node;
+                        qtree_impl_filter_add(qtree_obj, ins_node->key);
+                        ++batch_idx;
                     }
                     else
                     {
-                        rot_node->parent->greater = sub_node;
+                        node_list[merge_idx] = crt_node;
+                        crt_node = qtree_next(&iter);
+                        if (cmp_rc == 0)
+                        {
+                            qtree_impl_free_node(qtree_obj, ins_node);
+                            ++batch_idx;
+                            rc = QTREE_ERR_EXISTS;
+                        }
                     }
+                    ++merge_idx;
                 }
-                else
+                while (crt_node != NULL)
                 {
-                    qtree_obj->root = sub_node;
+                    node_list[merge_idx] = crt_node;
+                    crt_node = qtree_next(&iter);
+                    ++merge_idx;
                 }
 
-                rot_node->less = sub_node->greater;
-                if (sub_node->greater != NULL)
-                {
-                    sub_node->greater->parent = rot_node;
-                }
+                qtree_impl_link_sorted(qtree_obj, node_list, merge_idx, NULL, &qtree_obj->root);
+                qtree_impl_thread_list(qtree_obj, node_list, merge_idx);
+                qtree_obj->min_node = node_list[0];
+                qtree_obj->max_node = node_list[merge_idx - 1];
+                qtree_obj->size = merge_idx;
+            }
+            free(node_list);
+        }
+        else
+        {
+            rc = QTREE_ERR_NOMEM;
+        }
+    }
+
+    return rc;
+}
 
-                sub_node->greater = rot_node;
-                rot_node->parent  = sub_node;
 
-                if (sub_node->balance == 0)
+void qtree_remove(qtree *qtree_obj, const void *key_ptr)
+{
+    qtree_node *node = qtree_impl_find_node(qtree_obj, key_ptr);
+    if (node != NULL)
+    {
+        qtree_impl_remove_node(qtree_obj, node);
+    }
+}
+
+
+/**
+ * Removes the entry of a node of the tree and deallocates the node
+ *
+ * The node's key and value may be freed after this function returns, but not
+ * before, because the key is passed to the hash function of an attached filter.
+ */
+void qtree_remove_node(qtree *qtree_obj, qtree_node *node)
+{
+    qtree_impl_remove_node(qtree_obj, node);
+}
+
+
+/**
+ * Removes the entry of a node of the tree without deallocating the node
+ *
+ * Same as qtree_remove_node() regarding the lifetime of the node's key.
+ */
+void qtree_unlink_node(qtree *qtree_obj, qtree_node *node)
+{
+    qtree_impl_unlink_node(qtree_obj, node);
+}
+
+
+/**
+ * Removes all entries with keys from low up to and including high in O(log n + k)
+ *
+ * The range is cut out of the tree by two splits and a single join instead of
+ * removing and rebalancing each entry. If a visitor is specified, it is called
+ * for each removed entry in ascending order of keys before the entry's node is
+ * deallocated, e.g. for freeing the key and value.
+ *
+ * @return number of removed entries
+ */
+size_t qtree_remove_range(
+    qtree                   *qtree_obj,
+    const void              *low,
+    const void              *high,
+    const qtree_visit_func  visitor,
+    void                    *context
+)
+{
+    size_t count = 0;
+    if (qtree_obj->root != NULL && qtree_obj->qtree_cmp(low, high) <= 0)
+    {
+        if ((qtree_obj->options & QTREE_OPT_THREADED) != 0)
+        {
+            qtree_node *first_node = qtree_impl_find_bound(qtree_obj, low, QTREE_DIR_GREATER, true);
+            qtree_node *last_node  = qtree_impl_find_bound(qtree_obj, high, QTREE_DIR_LESS, true);
+            if (first_node != NULL && last_node != NULL &&
+                qtree_obj->qtree_cmp(first_node->key, last_node->key) <= 0)
+            {
+                qtree_links *first_links = &QTREE_LINKS(qtree_obj->links_offset, first_node);
+                qtree_links *last_links  = &QTREE_LINKS(qtree_obj->links_offset, last_node);
+                if (first_links->prev != NULL)
                 {
-                    rot_node->balance = -1;
-                    sub_node->balance = 1;
-                    break;
+                    QTREE_LINKS(qtree_obj->links_offset, first_links->prev).next = last_links->next;
                 }
-                else
+                if (last_links->next != NULL)
                 {
-                    rot_node->balance = 0;
-                    sub_node->balance = 0;
+                    QTREE_LINKS(qtree_obj->links_offset, last_links->next).prev = first_links->prev;
                 }
             }
-            else
+        }
+
+        qtree_node *less_root = NULL;
+        qtree_node *rest_root = NULL;
+        int less_height = 0;
+        int rest_height = 0;
+        qtree_node *low_node = qtree_impl_split(
+            qtree_obj, qtree_obj->root, qtree_impl_height(qtree_obj->root), low,
+            &less_root, &less_height, &rest_root, &rest_height
+        );
+
+        qtree_node *mid_root     = NULL;
+        qtree_node *greater_root = NULL;
+        int mid_height     = 0;
+        int greater_height = 0;
+        qtree_node *high_node = qtree_impl_split(
+            qtree_obj, rest_root, rest_height, high,
+            &mid_root, &mid_height, &greater_root, &greater_height
+        );
+
+        int height = 0;
+        qtree_obj->root = qtree_impl_join2(
+            qtree_obj, less_root, less_height, greater_root, greater_height, &height
+        );
+
+        count += qtree_impl_free_subtree(qtree_obj, low_node, visitor, context);
+        count += qtree_impl_free_subtree(qtree_obj, mid_root, visitor, context);
+        if (high_node != low_node)
+        {
+            count += qtree_impl_free_subtree(qtree_obj, high_node, visitor, context);
+        }
+
+        qtree_obj->size -= count;
+        qtree_impl_update_bounds(qtree_obj);
+    }
+
+    return count;
+}
+
+
+void *qtree_get(const qtree *qtree_obj, const void *key_ptr)
+{
+    const void *value = NULL;
+    qtree_node *node  = qtree_impl_find_node(qtree_obj, key_ptr);
+    if (node != NULL)
+    {
+        value = node->value;
+    }
+    return (void *) value;
+}
+
+
+qtree_node *qtree_get_node(const qtree *qtree_obj, const void *key)
+{
+    return qtree_impl_find_node(qtree_obj, key);
+}
+
+
+/**
+ * Looks up multiple keys, storing the value for each key, or NULL if the key
+ * is not present, in the corresponding element of values_out
+ *
+ * The lookups are advanced in lockstep and the memory required for the next
+ * step of each lookup is prefetched, so that cache misses of different
+ * lookups overlap instead of being waited for one after another.
+ */
+void qtree_get_batch(
+    const qtree *qtree_obj,
+    const void  *keys[],
+    void        *values_out[],
+    const size_t count
+)
+{
+    const bool use_prefix = qtree_obj->qtree_prefix != NULL;
+    for (size_t base_idx = 0; base_idx < count; base_idx += QTREE_BATCH_LANES)
+    {
+        const size_t lane_count = count - base_idx < QTREE_BATCH_LANES ?
+            count - base_idx : QTREE_BATCH_LANES;
+
+        qtree_node *lane_node[QTREE_BATCH_LANES];
+        uint64_t   lane_prefix[QTREE_BATCH_LANES];
+        size_t active_count = 0;
+        for (size_t lane = 0; lane < lane_count; ++lane)
+        {
+            lane_node[lane]   = qtree_impl_filter_contains(qtree_obj, keys[base_idx + lane]) ?
+                qtree_obj->root : NULL;
+            lane_prefix[lane] = qtree_impl_prefix(qtree_obj, keys[base_idx + lane]);
+            values_out[base_idx + lane] = NULL;
+            if (lane_node[lane] != NULL)
             {
-                // rotate LR
-                if (sub_node->greater->balance == -1)
-                {
-                    sub_node->balance = 0;
-                    rot_node->balance = 1;
-                }
-                else
-                if (sub_node->greater->balance == 1)
-                {
-                    sub_node->balance = -1;
-                    rot_node->balance = 0;
-                }
-                else
-                {
-                    sub_node->balance = 0;
-                    rot_node->balance = 0;
-                }
-                sub_node->greater->balance = 0;
+                ++active_count;
+            }
+        }
 
-                sub_node->parent         = sub_node->greater;
-                sub_node->greater        = sub_node->greater->less;
-                sub_node->parent->less   = sub_node;
-                rot_node->less           = sub_node->parent->greater;
-                sub_node->parent->parent = rot_node->parent;
-                if (sub_node->greater != NULL)
-                {
-                    sub_node->greater->parent = sub_node;
-                }
-                if (rot_node->less != NULL)
+        while (active_count > 0)
+        {
+            // The nodes were prefetched by the previous step, the keys
+            // referenced by the nodes are prefetched before comparing any
+            for (size_t lane = 0; lane < lane_count; ++lane)
+            {
+                // A key is only compared if the prefixes are equal
+                if (lane_node[lane] != NULL &&
+                    (!use_prefix || QTREE_PREFIX(qtree_obj, lane_node[lane]) == lane_prefix[lane]))
                 {
-                    rot_node->less->parent = rot_node;
+                    QTREE_PREFETCH(lane_node[lane]->key);
                 }
+            }
 
-                if (rot_node->parent != NULL)
+            for (size_t lane = 0; lane < lane_count; ++lane)
+            {
+                qtree_node *node = lane_node[lane];
+                if (node != NULL)
                 {
-                    if (rot_node->parent->less == rot_node)
+                    const int cmp_rc = qtree_impl_cmp(qtree_obj, keys[base_idx + lane], lane_prefix[lane], node, use_prefix);
+                    if (cmp_rc < 0)
                     {
-                        rot_node->parent->less = sub_node->parent;
+                        node = node->less;
                     }
                     else
+                    if (cmp_rc > 0)
                     {
-                        rot_node->parent->greater = sub_node->parent;
+                        node = node->greater;
+                    }
+                    else
+                    {
+                        values_out[base_idx + lane] = (void *) node->value;
+                        node = NULL;
                     }
-                }
-                else
-                {
-                    qtree_obj->root = sub_node->parent;
-                }
 
-                rot_node->parent          = sub_node->parent;
-                sub_node->parent->greater = rot_node;
-            }
-            rot_node = rot_node->parent;
-            // end of R / LR rotations
-        }
-        else
-        if (rot_node->balance == 2)
-        {
-            qtree_node *sub_node = rot_node->greater;
-            // 0 or 1
-            if (sub_node->balance >= 0)
-            {
-                // rotate L
-                sub_node->parent = rot_node->parent;
-                if (rot_node->parent != NULL)
-                {
-                    if (rot_node->parent->less == rot_node)
+                    if (node != NULL)
                     {
-                        rot_node->parent->less = sub_node;
+                        QTREE_PREFETCH(node);
                     }
                     else
                     {
-                        rot_node->parent->greater = sub_node;
+                        --active_count;
                     }
+                    lane_node[lane] = node;
                 }
-                else
-                {
-                    qtree_obj->root = sub_node;
-                }
+            }
+        }
+    }
+}
 
-                rot_node->greater = sub_node->less;
-                if (sub_node->less != NULL)
-                {
-                    sub_node->less->parent = rot_node;
-                }
 
-                sub_node->less   = rot_node;
-                rot_node->parent = sub_node;
-                if (sub_node->balance == 0)
-                {
-                    rot_node->balance = 1;
-                    sub_node->balance = -1;
-                    break;
-                }
-                else
-                {
-                    rot_node->balance = 0;
-                    sub_node->balance = 0;
-                }
-            }
-            else
-            {
-                // rotate RL
-                if (sub_node->less->balance == -1)
-                {
-                    sub_node->balance = 1;
-                    rot_node->balance = 0;
-                }
-                else
-                if (sub_node->less->balance == 1)
-                {
-                    sub_node->balance = 0;
-                    rot_node->balance = -1;
-                }
-                else
-                {
-                    sub_node->balance = 0;
-                    rot_node->balance = 0;
-                }
-                sub_node->less->balance = 0;
+size_t qtree_get_size(const qtree *qtree_obj)
+{
+    return qtree_obj->size;
+}
 
-                sub_node->parent          = sub_node->less;
-                sub_node->less            = sub_node->less->greater;
-                sub_node->parent->greater = sub_node;
-                rot_node->greater         = sub_node->parent->less;
-                sub_node->parent->parent  = rot_node->parent;
-                if (sub_node->less != NULL)
-                {
+
+qtree_it *qtree_iterator(const qtree *qtree_obj)
+{
+    qtree_it *iter = malloc(sizeof (qtree_it));
+    if (iter != NULL)
+    {
+        qtree_impl_iterator_init(qtree_obj, iter);
+    }
+    return iter;
+}
+
+
+void qtree_iterator_init(const qtree *qtree_obj, qtree_it *iter)
+{
+    qtree_impl_iterator_init(qtree_obj, iter);
+}
+
+
+qtree_node *qtree_next(qtree_it *iter)
+{
+    qtree_node *ret_node = iter->next;
+
+    if (ret_node != NULL)
+    {
+        qtree_node *next_node = iter->links_offset != 0 ? QTREE_LINKS(iter->links_offset, ret_node).next : qtree_impl_successor(ret_node);
+        iter->next = next_node != iter->end ? next_node : NULL;
+    }
+    iter->current = ret_node;
+
+    return ret_node;
+}
+
+
+qtree_node *qtree_prev(qtree_it *iter)
+{
+    qtree_node *ret_node = iter->next;
+
+    if (ret_node != NULL)
+    {
+        qtree_node *next_node = iter->links_offset != 0 ? QTREE_LINKS(iter->links_offset, ret_node).prev : qtree_impl_predecessor(ret_node);
+        iter->next = next_node != iter->end ? next_node : NULL;
+    }
+    iter->current = ret_node;
+
+    return ret_node;
+}
+
+
+/**
+ * Removes the entry that was returned by the most recent call of qtree_next()
+ * or qtree_prev() on the iterator
+ *
+ * The node is removed without searching for its key, and the iterator remains
+ * valid for continuing the iteration. The caller is responsible for freeing the
+ * node's key and value after this function has returned; the key must remain
+ * valid until then, because it is passed to the hash function of an attached filter.
+ */
+void qtree_iterator_remove(qtree *qtree_obj, qtree_it *iter)
+{
+    if (iter->current != NULL)
+    {
+        qtree_impl_remove_node(qtree_obj, iter->current);
+        iter->current = NULL;
+    }
+}
+
+
+/**
+ * Initializes an iterator for use with qtree_prev() that starts at the greatest key
+ */
+void qtree_iterator_init_reverse(const qtree *qtree_obj, qtree_it *iter)
+{
+    iter->next         = qtree_obj->max_node;
+    iter->end          = NULL;
+    iter->current      = NULL;
+    iter->links_offset = qtree_obj->links_offset;
+}
+
+
+/**
+ * Initializes an iterator for use with qtree_next() that starts at the first key
+ * that is greater than or equal to the specified key
+ */
+void qtree_iterator_seek(const qtree *qtree_obj, qtree_it *iter, const void *key)
+{
+    iter->next         = qtree_impl_find_bound(qtree_obj, key, QTREE_DIR_GREATER, true);
+    iter->end          = NULL;
+    iter->current      = NULL;
+    iter->links_offset = qtree_obj->links_offset;
+}
+
+
+/**
+ * Initializes an iterator for use with qtree_prev() that starts at the last key
+ * that is less than or equal to the specified key
+ */
+void qtree_iterator_seek_reverse(const qtree *qtree_obj, qtree_it *iter, const void *key)
+{
+    iter->next         = qtree_impl_find_bound(qtree_obj, key, QTREE_DIR_LESS, true);
+    iter->end          = NULL;
+    iter->current      = NULL;
+    iter->links_offset = qtree_obj->links_offset;
+}
+
+
+/**
+ * Initializes an iterator for use with qtree_next() that returns the entries
+ * with keys from start_key up to and including end_key
+ *
+ * The end of the range is determined once, so iterating the range does not
+ * compare any keys.
+ */
+void qtree_range_iterator_init(
+    const qtree *qtree_obj,
+    qtree_it    *iter,
+    const void  *start_key,
+    const void  *end_key
+)
+{
+    iter->next         = qtree_impl_find_bound(qtree_obj, start_key, QTREE_DIR_GREATER, true);
+    iter->end          = qtree_impl_find_bound(qtree_obj, end_key, QTREE_DIR_GREATER, false);
+    iter->current      = NULL;
+    iter->links_offset = qtree_obj->links_offset;
+    if (iter->next != NULL && qtree_obj->qtree_cmp(iter->next->key, end_key) > 0)
+    {
+        iter->next = NULL;
+    }
+}
+
+
+/**
+ * Initializes an iterator for use with qtree_prev() that returns the entries
+ * with keys from start_key down to and including end_key
+ */
+void qtree_range_iterator_init_reverse(
+    const qtree *qtree_obj,
+    qtree_it    *iter,
+    const void  *start_key,
+    const void  *end_key
+)
+{
+    iter->next         = qtree_impl_find_bound(qtree_obj, start_key, QTREE_DIR_LESS, true);
+    iter->end          = qtree_impl_find_bound(qtree_obj, end_key, QTREE_DIR_LESS, false);
+    iter->current      = NULL;
+    iter->links_offset = qtree_obj->links_offset;
+    if (iter->next != NULL && qtree_obj->qtree_cmp(iter->next->key, end_key) < 0)
+    {
+        iter->next = NULL;
+    }
+}
+
+
+/**
+ * @return the node with the least key in O(1), or NULL if the tree is empty
+ */
+qtree_node *qtree_peek_min(const qtree *qtree_obj)
+{
+    return qtree_obj->min_node;
+}
+
+
+/**
+ * @return the node with the greatest key in O(1), or NULL if the tree is empty
+ */
+qtree_node *qtree_peek_max(const qtree *qtree_obj)
+{
+    return qtree_obj->max_node;
+}
+
+
+/**
+ * Removes the entry with the least key, storing its key and value unless the
+ * respective pointer is NULL
+ *
+ * Takes amortized O(1), because the removed node is found without a search.
+ *
+ * @return true if an entry was removed, false if the tree is empty
+ */
+bool qtree_pop_min(qtree *qtree_obj, const void **key, const void **value)
+{
+    qtree_node *node = qtree_obj->min_node;
+    if (node != NULL)
+    {
+        if (key != NULL)
+        {
+            *key = node->key;
+        }
+        if (value != NULL)
+        {
+            *value = node->value;
+        }
+        qtree_impl_remove_node(qtree_obj, node);
+    }
+    return node != NULL;
+}
+
+
+/**
+ * Removes the entry with the greatest key, same as qtree_pop_min() otherwise
+ */
+bool qtree_pop_max(qtree *qtree_obj, const void **key, const void **value)
+{
+    qtree_node *node = qtree_obj->max_node;
+    if (node != NULL)
+    {
+        if (key != NULL)
+        {
+            *key = node->key;
+        }
+        if (value != NULL)
+        {
+            *value = node->value;
+        }
+        qtree_impl_remove_node(qtree_obj, node);
+    }
+    return node != NULL;
+}
+
+
+/**
+ * Removes all entries with keys less than or equal to the specified key in
+ * ascending order of keys
+ *
+ * If a visitor is specified, it is called for each entry before the entry's
+ * node is deallocated, e.g. for freeing the key and value.
+ *
+ * @return number of removed entries
+ */
+size_t qtree_pop_until(
+    qtree                   *qtree_obj,
+    const void              *key,
+    const qtree_visit_func  visitor,
+    void                    *context
+)
+{
+    size_t count = 0;
+    const uint64_t key_prefix = qtree_impl_prefix(qtree_obj, key);
+    const bool use_prefix = qtree_obj->qtree_prefix != NULL;
+    qtree_node *node = qtree_obj->min_node;
+    while (node != NULL && qtree_impl_cmp(qtree_obj, key, key_prefix, node, use_prefix) >= 0)
+    {
+        // The node is unlinked before the visitor may free its key
+        qtree_impl_unlink_node(qtree_obj, node);
+        if (visitor != NULL)
+        {
+            visitor(node, context);
+        }
+        qtree_impl_free_node(qtree_obj, node);
+        ++count;
+        node = qtree_obj->min_node;
+    }
+    return count;
+}
+
+
+/**
+ * Returns the node with the least key that is greater than or equal to the specified key
+ */
+qtree_node *qtree_lower_bound(const qtree *qtree_obj, const void *key)
+{
+    return qtree_impl_find_bound(qtree_obj, key, QTREE_DIR_GREATER, true);
+}
+
+
+/**
+ * Returns the node with the least key that is greater than the specified key
+ */
+qtree_node *qtree_upper_bound(const qtree *qtree_obj, const void *key)
+{
+    return qtree_impl_find_bound(qtree_obj, key, QTREE_DIR_GREATER, false);
+}
+
+
+/**
+ * Returns the node with the greatest key that is less than or equal to the specified key
+ */
+qtree_node *qtree_floor(const qtree *qtree_obj, const void *key)
+{
+    return qtree_impl_find_bound(qtree_obj, key, QTREE_DIR_LESS, true);
+}
+
+
+/**
+ * Same as qtree_lower_bound(), named as the counterpart of qtree_floor()
+ */
+qtree_node *qtree_ceiling(const qtree *qtree_obj, const void *key)
+{
+    return qtree_lower_bound(qtree_obj, key);
+}
+
+
+/**
+ * Returns the node at the specified zero-based position in key order
+ *
+ * Requires a tree initialized with QTREE_OPT_ORDER_STATS.
+ */
+qtree_node *qtree_select(const qtree *qtree_obj, size_t index)
+{
+    qtree_node *node = qtree_obj->root;
+    while (node != NULL)
+    {
+        const size_t less_count = qtree_impl_count(qtree_obj, node->less);
+        if (index < less_count)
+        {
+            node = node->less;
+        }
+        else
+        if (index > less_count)
+        {
+            index -= less_count + 1;
+            node = node->greater;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    return node;
+}
+
+
+/**
+ * Returns the number of keys that are less than the specified key
+ *
+ * Requires a tree initialized with QTREE_OPT_ORDER_STATS.
+ */
+size_t qtree_rank(const qtree *qtree_obj, const void *key)
+{
+    return qtree_impl_rank(qtree_obj, key, false);
+}
+
+
+/**
+ * Returns the number of keys from start_key up to and including end_key
+ *
+ * Requires a tree initialized with QTREE_OPT_ORDER_STATS.
+ */
+size_t qtree_count_range(const qtree *qtree_obj, const void *start_key, const void *end_key)
+{
+    size_t count = 0;
+    if (qtree_obj->qtree_cmp(start_key, end_key) <= 0)
+    {
+        count = qtree_impl_rank(qtree_obj, end_key, true) - qtree_impl_rank(qtree_obj, start_key, false);
+    }
+    return count;
+}
+
+
+/**
+ * Moves all entries of src into dst, leaving src empty
+ *
+ * For keys that are present in both trees, the entry of dst is kept and the
+ * node of src is deallocated. If a visitor is specified, it is called for each
+ * such node of src before it is deallocated, e.g. for freeing the key and value.
+ * Both trees must have the same callbacks, options and node layout; otherwise,
+ * QTREE_ERR_UNSUPPORTED is returned and neither tree is modified.
+ * In arena mode, the slabs of src are passed on to dst, as by qtree_join().
+ * The filters of both trees become stale, unless src is empty.
+ */
+qtree_rc qtree_union(qtree *dst, qtree *src, const qtree_visit_func visitor, void *context)
+{
+    return qtree_impl_set_run(dst, src, QTREE_SET_UNION, 1, visitor, context);
+}
+
+
+/**
+ * Removes all entries from dst whose keys are not present in src
+ *
+ * src is not modified, and the removed nodes are released by dst, so either
+ * tree may use QTREE_OPT_ARENA.
+ */
+void qtree_intersection(qtree *dst, const qtree *src)
+{
+    qtree_impl_set_run(dst, (qtree *) src, QTREE_SET_INTERSECTION, 1, NULL, NULL);
+}
+
+
+/**
+ * Removes all entries from dst whose keys are present in src
+ *
+ * As for qtree_intersection(), either tree may use QTREE_OPT_ARENA.
+ */
+void qtree_difference(qtree *dst, const qtree *src)
+{
+    qtree_impl_set_run(dst, (qtree *) src, QTREE_SET_DIFFERENCE, 1, NULL, NULL);
+}
+
+
+/**
+ * Same as qtree_union(), but distributes the work across up to thread_count threads
+ *
+ * The comparator must be safe to call from multiple threads concurrently. The
+ * visitor is called by the calling thread after all other threads have finished.
+ */
+qtree_rc qtree_union_parallel(
+    qtree                   *dst,
+    qtree                   *src,
+    const size_t            thread_count,
+    const qtree_visit_func  visitor,
+    void                    *context
+)
+{
+    return qtree_impl_set_run(dst, src, QTREE_SET_UNION, thread_count, visitor, context);
+}
+
+
+/**
+ * Same as qtree_intersection(), but distributes the work across up to thread_count threads
+ */
+void qtree_intersection_parallel(qtree *dst, const qtree *src, const size_t thread_count)
+{
+    qtree_impl_set_run(dst, (qtree *) src, QTREE_SET_INTERSECTION, thread_count, NULL, NULL);
+}
+
+
+/**
+ * Same as qtree_difference(), but distributes the work across up to thread_count threads
+ */
+void qtree_difference_parallel(qtree *dst, const qtree *src, const size_t thread_count)
+{
+    qtree_impl_set_run(dst, (qtree *) src, QTREE_SET_DIFFERENCE, thread_count, NULL, NULL);
+}
+
+
+/**
+ * Returns the aggregate of the entries with keys from low up to and including high in O(log n)
+ *
+ * Returns the identity if there are no such entries. Requires a tree initialized
+ * by qtree_init_aggregate().
+ */
+qtree_aggr qtree_aggregate_range(const qtree *qtree_obj, const void *low, const void *high)
+{
+    const qtree_aggr_combine_func combine = qtree_obj->aggr_combine;
+    qtree_aggr result = qtree_obj->aggr_identity;
+
+    const uint64_t low_prefix  = qtree_impl_prefix(qtree_obj, low);
+    const uint64_t high_prefix = qtree_impl_prefix(qtree_obj, high);
+    const bool     use_prefix  = qtree_obj->qtree_prefix != NULL;
+
+    // Find the highest node within the range, where the paths to low and high diverge
+    qtree_node *split_node = qtree_obj->root;
+    while (split_node != NULL)
+    {
+        if (qtree_impl_cmp(qtree_obj, low, low_prefix, split_node, use_prefix) > 0)
+        {
+            split_node = split_node->greater;
+        }
+        else
+        if (qtree_impl_cmp(qtree_obj, high, high_prefix, split_node, use_prefix) < 0)
+        {
+            split_node = split_node->less;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    if (split_node != NULL)
+    {
+        // Nodes on the path to low that are within the range are included with
+        // their greater subtrees, each preceding the part that was collected before
+        qtree_aggr less_aggr = qtree_obj->aggr_identity;
+        const qtree_node *node = split_node->less;
+        while (node != NULL)
+        {
+            if (qtree_impl_cmp(qtree_obj, low, low_prefix, node, use_prefix) <= 0)
+            {
+                less_aggr = combine(
+                    combine(qtree_obj->aggr_map(node->key, node->value), qtree_impl_aggregate(qtree_obj, node->greater)),
+                    less_aggr
+                );
+                node = node->less;
+            }
+            else
+            {
+                node = node->greater;
+            }
+        }
+
+        qtree_aggr greater_aggr = qtree_obj->aggr_identity;
+        node = split_node->greater;
+        while (node != NULL)
+        {
+            if (qtree_impl_cmp(qtree_obj, high, high_prefix, node, use_prefix) >= 0)
+            {
+                greater_aggr = combine(
+                    greater_aggr,
+                    combine(qtree_impl_aggregate(qtree_obj, node->less), qtree_obj->aggr_map(node->key, node->value))
+                );
+                node = node->greater;
+            }
+            else
+            {
+                node = node->less;
+            }
+        }
+
+        result = combine(
+            combine(less_aggr, qtree_obj->aggr_map(split_node->key, split_node->value)),
+            greater_aggr
+        );
+    }
+
+    return result;
+}
+
+
+/**
+ * Recalculates the data that is kept about the subtrees that contain the node,
+ * which is required after the node's value was changed in place
+ *
+ * Takes O(log n) for trees with QTREE_OPT_AGGREGATE or QTREE_OPT_INTERVAL, and
+ * does nothing otherwise.
+ */
+void qtree_refresh_node(const qtree *qtree_obj, qtree_node *node)
+{
+    qtree_impl_update_path(qtree_obj, node);
+}
+
+
+/**
+ * Calls the visitor for each interval that overlaps the range from low to high,
+ * in ascending order of interval starts
+ *
+ * Subtrees whose greatest interval end is less than low, and subtrees of
+ * intervals that start after high, are skipped. Requires a tree initialized
+ * by qtree_init_interval().
+ */
+void qtree_interval_overlaps(
+    const qtree             *qtree_obj,
+    const void              *low,
+    const void              *high,
+    const qtree_visit_func  visitor,
+    void                    *context
+)
+{
+    qtree_impl_overlaps(qtree_obj, qtree_obj->root, low, high, visitor, context);
+}
+
+
+/**
+ * Calls the visitor for each interval that contains the specified point
+ *
+ * Requires a tree initialized by qtree_init_interval().
+ */
+void qtree_interval_stab(
+    const qtree             *qtree_obj,
+    const void              *point,
+    const qtree_visit_func  visitor,
+    void                    *context
+)
+{
+    qtree_impl_overlaps(qtree_obj, qtree_obj->root, point, point, visitor, context);
+}
+
+
+/**
+ * Calls the visitor for each node in ascending order of keys
+ *
+ * The traversal uses an explicit stack instead of following parent pointers.
+ * The visitor must not modify the structure of the tree.
+ */
+void qtree_foreach(const qtree *qtree_obj, const qtree_visit_func visitor, void *context)
+{
+    qtree_impl_visit_subtree(qtree_obj->root, visitor, context);
+}
+
+
+/**
+ * Calls the visitor for each node, distributing the work across up to thread_count threads
+ *
+ * The tree is divided by subtrees into up to thread_count partitions of
+ * consecutive keys, and contexts must provide one context per partition.
+ * Each partition is traversed in ascending order of keys by a single thread
+ * that passes the partition's context to the visitor; partitions of lower keys
+ * have lower indices. A tree that is too small to be divided further has fewer
+ * partitions, which use the contexts at the lowest indices, and the remaining
+ * contexts are not used. If a reducer is specified, it is called after all
+ * threads have finished, in ascending order of partitions, to combine the
+ * context of each further partition into contexts[0].
+ * The visitor must not modify the structure of the tree.
+ *
+ * @return number of partitions
+ */
+size_t qtree_parallel_foreach(
+    const qtree             *qtree_obj,
+    const qtree_visit_func  visitor,
+    void                    *contexts[],
+    const size_t            thread_count,
+    const qtree_reduce_func reducer
+)
+{
+    size_t part_count = 0;
+    if (thread_count > 0)
+    {
+        qtree_visit_task task;
+        task.lead_node  = NULL;
+        task.sub_root   = qtree_obj->root;
+        task.sub_height = qtree_impl_height(qtree_obj->root);
+        task.visitor    = visitor;
+        task.contexts   = contexts;
+        task.part_count = thread_count;
+        qtree_impl_visit_parallel(&task);
+
+        part_count = qtree_impl_visit_part_count(task.sub_root, task.sub_height, thread_count);
+        if (reducer != NULL)
+        {
+            for (size_t idx = 1; idx < part_count; ++idx)
+            {
+                reducer(contexts[0], contexts[idx]);
+            }
+        }
+    }
+    return part_count;
+}
+
+
+/**
+ * Moves the entries of src with keys less than the specified key into less_tree
+ * and all other entries into greater_tree, leaving src empty
+ *
+ * The nodes are relinked in O(log n) without being reallocated. The sizes of
+ * the two trees are taken from the node counts of a tree initialized with
+ * QTREE_OPT_ORDER_STATS, or are counted otherwise in O(min(m, n - m)), where m
+ * is the number of entries less than the key.
+ * The nodes of a tree in arena mode belong to its slabs, which are passed on to
+ * the larger of the two trees; the nodes of the smaller tree are copied into a
+ * new slab in O(min(m, n - m)), which invalidates all pointers to them. If that
+ * slab cannot be allocated, QTREE_ERR_NOMEM is returned and src keeps all entries.
+ * less_tree and greater_tree must be initialized trees, which may be the same
+ * object as src, or must be empty otherwise. Their filters are released, and
+ * they are reinitialized with the comparator and options of src.
+ * A filter attached to src is passed on to less_tree, where it becomes stale,
+ * unless greater_tree is empty.
+ */
+qtree_rc qtree_split(qtree *src, const void *key, qtree *less_tree, qtree *greater_tree)
+{
+    qtree_rc rc = QTREE_PASS;
+
+    if (less_tree != src)
+    {
+        qtree_impl_release_empty(less_tree);
+    }
+    if (greater_tree != src)
+    {
+        qtree_impl_release_empty(greater_tree);
+    }
+
+    const size_t size = src->size;
+
+    qtree_node *less_root    = NULL;
+    qtree_node *greater_root = NULL;
+    int less_height    = 0;
+    int greater_height = 0;
+    qtree_node *key_node = qtree_impl_split(
+        src, src->root, qtree_impl_height(src->root), key,
+        &less_root, &less_height, &greater_root, &greater_height
+    );
+    if (key_node != NULL)
+    {
+        greater_root = qtree_impl_join(
+            src, NULL, 0, key_node, greater_root, greater_height, &greater_height
+        );
+    }
+
+    size_t less_size = 0;
+    if ((src->options & QTREE_OPT_ORDER_STATS) != 0)
+    {
+        less_size = qtree_impl_count(src, less_root);
+    }
+    else
+    {
+        less_size = qtree_impl_count_less(less_root, greater_root, size);
+    }
+
+    // In arena mode, the smaller tree is copied into a slab of its own
+    const bool   arena       = (src->options & QTREE_OPT_ARENA) != 0;
+    const bool   copy_less   = less_size < size - less_size;
+    const size_t copy_size   = copy_less ? less_size : size - less_size;
+    qtree_slab   *copy_slab  = NULL;
+    if (arena && copy_size > 0)
+    {
+        copy_slab = malloc(sizeof (qtree_slab) + copy_size * src->node_size);
+        if (copy_slab == NULL)
+        {
+            src->root = qtree_impl_join2(
+                src, less_root, less_height, greater_root, greater_height, &less_height
+            );
+            rc = QTREE_ERR_NOMEM;
+        }
+    }
+
+    if (rc == QTREE_PASS)
+    {
+        const qtree model_obj = *src;
+        src->root       = NULL;
+        src->min_node   = NULL;
+        src->max_node   = NULL;
+        src->size       = 0;
+        src->slab_list  = NULL;
+        src->free_list  = NULL;
+        src->slab_avail = 0;
+        src->filter     = NULL;
+
+        qtree_impl_init_like(less_tree, &model_obj);
+        qtree_impl_init_like(greater_tree, &model_obj);
+        if (arena)
+        {
+            qtree *keep_tree = copy_less ? greater_tree : less_tree;
+            keep_tree->slab_list  = model_obj.slab_list;
+            keep_tree->free_list  = model_obj.free_list;
+            keep_tree->slab_avail = model_obj.slab_avail;
+            if (copy_slab != NULL)
+            {
+                copy_slab->next     = NULL;
+                copy_slab->capacity = copy_size;
+                qtree *copy_tree = copy_less ? less_tree : greater_tree;
+                copy_tree->slab_list = copy_slab;
+                if (copy_less)
+                {
+                    less_root = qtree_impl_copy_subtree(&model_obj, copy_slab, less_root, keep_tree);
+                }
+                else
+                {
+                    greater_root = qtree_impl_copy_subtree(&model_obj, copy_slab, greater_root, keep_tree);
+                }
+            }
+        }
+
+        less_tree->filter = model_obj.filter;
+        if (greater_root != NULL)
+        {
+            qtree_impl_filter_invalidate(less_tree);
+        }
+        less_tree->root = less_root;
+        less_tree->size = less_size;
+        qtree_impl_update_bounds(less_tree);
+        greater_tree->root = greater_root;
+        greater_tree->size = size - less_size;
+        qtree_impl_update_bounds(greater_tree);
+
+        if ((model_obj.options & QTREE_OPT_THREADED) != 0 && less_root != NULL && greater_root != NULL)
+        {
+            if (copy_slab != NULL)
+            {
+                qtree_impl_thread_tree(copy_less ? less_tree : greater_tree);
+            }
+            QTREE_LINKS(model_obj.links_offset, less_tree->max_node).next    = NULL;
+            QTREE_LINKS(model_obj.links_offset, greater_tree->min_node).prev = NULL;
+        }
+    }
+
+    return rc;
+}
+
+
+/**
+ * Moves all entries of greater_tree into less_tree in O(log n), leaving greater_tree empty
+ *
+ * All keys in less_tree must be less than all keys in greater_tree. Both trees
+ * must have the same comparator, callbacks, options and prefix function, and
+ * thus the same node layout; otherwise, QTREE_ERR_UNSUPPORTED is returned and
+ * neither tree is modified.
+ * In arena mode, the slabs of greater_tree are passed on to less_tree, which
+ * additionally takes time linear in the number of unused nodes of greater_tree.
+ * The filters of both trees become stale, unless greater_tree is empty.
+ */
+qtree_rc qtree_join(qtree *less_tree, qtree *greater_tree)
+{
+    qtree_rc rc = QTREE_PASS;
+
+    if (qtree_impl_same_layout(less_tree, greater_tree))
+    {
+        if (greater_tree->root != NULL)
+        {
+            qtree_impl_filter_invalidate(less_tree);
+            qtree_impl_filter_invalidate(greater_tree);
+        }
+        if ((less_tree->options & QTREE_OPT_ARENA) != 0)
+        {
+            qtree_impl_merge_arena(less_tree, greater_tree);
+        }
+
+        if ((less_tree->options & QTREE_OPT_THREADED) != 0 && less_tree->root != NULL && greater_tree->root != NULL)
+        {
+            QTREE_LINKS(less_tree->links_offset, less_tree->max_node).next    = greater_tree->min_node;
+            QTREE_LINKS(less_tree->links_offset, greater_tree->min_node).prev = less_tree->max_node;
+        }
+
+        int height = 0;
+        less_tree->root = qtree_impl_join2(
+            less_tree,
+            less_tree->root, qtree_impl_height(less_tree->root),
+            greater_tree->root, qtree_impl_height(greater_tree->root),
+            &height
+        );
+        less_tree->size += greater_tree->size;
+        if (greater_tree->root != NULL)
+        {
+            if (less_tree->min_node == NULL)
+            {
+                less_tree->min_node = greater_tree->min_node;
+            }
+            less_tree->max_node = greater_tree->max_node;
+        }
+        greater_tree->root     = NULL;
+        greater_tree->min_node = NULL;
+        greater_tree->max_node = NULL;
+        greater_tree->size     = 0;
+    }
+    else
+    {
+        rc = QTREE_ERR_UNSUPPORTED;
+    }
+
+    return rc;
+}
+
+
+/**
+ * Improves the memory locality of a tree that has been modified over a long time
+ *
+ * All nodes are relocated into a single contiguous slab in breadth-first order,
+ * so that the upper levels of the tree, which are visited by every search,
+ * share as few cache lines and pages as possible. The slabs that held the nodes
+ * before, including the free list, are released.
+ * If rebalance is true, the tree is first rebuilt into a balanced tree of minimal
+ * height.
+ *
+ * Only trees in arena mode can be compacted, since nodes that are not in arena
+ * mode are deallocated one by one. The whole tree is relocated at once; there is
+ * no incremental mode, as the tree could not be modified between the steps.
+ *
+ * Relocation invalidates all pointers to nodes of the tree, including iterators,
+ * so it must not be used on trees that contain nodes added using
+ * qtree_insert_node(). If memory allocation fails, the tree is not modified,
+ * except for being rebalanced.
+ */
+qtree_rc qtree_compact(qtree *qtree_obj, const bool rebalance)
+{
+    qtree_rc rc = QTREE_PASS;
+
+    if ((qtree_obj->options & QTREE_OPT_ARENA) == 0)
+    {
+        rc = QTREE_ERR_UNSUPPORTED;
+    }
+    else
+    if (qtree_obj->root != NULL)
+    {
+        if (rebalance)
+        {
+            rc = qtree_impl_rebuild_balanced(qtree_obj);
+        }
+        if (rc == QTREE_PASS)
+        {
+            rc = qtree_impl_relocate(qtree_obj);
+        }
+    }
+
+    return rc;
+}
+
+
+/**
+ * Rebalances the tree after node removal
+ *
+ * WARNING! The order of statements, especially assignments, in this function
+ *          is critical for the function's correct operation.
+ *          DO NOT CHANGE THE ORDER OF ANY STATEMENTS.
+ */
+static inline void qtree_impl_rebalance_remove(
+    qtree       *qtree_obj,
+    qtree_dir   dir,
+    qtree_node  *rot_node
+)
+{
+    // update balance and perform rotations
+    while (rot_node != NULL)
+    {
+        if (dir == QTREE_DIR_LESS)
+        {
+            // node was removed from left subtree
+            ++rot_node->balance;
+            if (rot_node->balance == 1)
+            {
+                break;
+            }
+        }
+        else
+        {
+            // node was removed from right subtree
+            --rot_node->balance;
+            if (rot_node->balance == -1)
+            {
+                break;
+            }
+        }
+
+        if (rot_node->parent != NULL)
+        {
+            if (rot_node->parent->less == rot_node)
+            {
+                dir = QTREE_DIR_LESS;
+            }
+            else
+            {
+                dir = QTREE_DIR_GREATER;
+            }
+        }
+
+        // update balance and perform rotations
+        if (rot_node->balance == -2)
+        {
+            qtree_node *sub_node = rot_node->less;
+            // 0 or -1
+            if (sub_node->balance <= 0)
+            {
+                // rotate R
+                sub_node->parent = rot_node->parent;
+                if (rot_node->parent != NULL)
+                {
+                    if (rot_node->parent->less == rot_node)
+                    {
+                        QTREE_STORE_LINK(qtree_obj, rot_node->parent->less, sub_node);
+                    }
+                    else
+                    {
+                        QTREE_STORE_LINK(qtree_obj, rot_node->parent->greater, sub_node);
+                    }
+                }
+                else
+                {
+                    QTREE_STORE_LINK(qtree_obj, qtree_obj->root, sub_node);
+                }
+
+                QTREE_STORE_LINK(qtree_obj, rot_node->less, sub_node->greater);
+                if (sub_node->greater != NULL)
+                {
+                    sub_node->greater->parent = rot_node;
+                }
+
+                QTREE_STORE_LINK(qtree_obj, sub_node->greater, rot_node);
+                rot_node->parent = sub_node;
+
+                qtree_impl_update_node(qtree_obj, rot_node);
+                qtree_impl_update_node(qtree_obj, sub_node);
+
+                if (sub_node->balance == 0)
+                {
+                    rot_node->balance = -1;
+                    sub_node->balance = 1;
+                    break;
+                }
+                else
+                {
+                    rot_node->balance = 0;
+                    sub_node->balance = 0;
+                }
+            }
+            else
+            {
+                // rotate LR
+                if (sub_node->greater->balance == -1)
+                {
+                    sub_node->balance = 0;
+                    rot_node->balance = 1;
+                }
+                else
+                if (sub_node->greater->balance == 1)
+                {
+                    sub_node->balance = -1;
+                    rot_node->balance = 0;
+                }
+                else
+                {
+                    sub_node->balance = 0;
+                    rot_node->balance = 0;
+                }
+                sub_node->greater->balance = 0;
+
+                sub_node->parent = sub_node->greater;
+                QTREE_STORE_LINK(qtree_obj, sub_node->greater, sub_node->greater->less);
+                QTREE_STORE_LINK(qtree_obj, sub_node->parent->less, sub_node);
+                QTREE_STORE_LINK(qtree_obj, rot_node->less, sub_node->parent->greater);
+                sub_node->parent->parent = rot_node->parent;
+                if (sub_node->greater != NULL)
+                {
+                    sub_node->greater->parent = sub_node;
+                }
+                if (rot_node->less != NULL)
+                {
+                    rot_node->less->parent = rot_node;
+                }
+
+                if (rot_node->parent != NULL)
+                {
+                    if (rot_node->parent->less == rot_node)
+                    {
+                        QTREE_STORE_LINK(qtree_obj, rot_node->parent->less, sub_node->parent);
+                    }
+                    else
+                    {
+                        QTREE_STORE_LINK(qtree_obj, rot_node->parent->greater, sub_node->parent);
+                    }
+                }
+                else
+                {
+                    QTREE_STORE_LINK(qtree_obj, qtree_obj->root, sub_node->parent);
+                }
+
+                rot_node->parent = sub_node->parent;
+                QTREE_STORE_LINK(qtree_obj, sub_node->parent->greater, rot_node);
+
+                qtree_impl_update_node(qtree_obj, sub_node);
+                qtree_impl_update_node(qtree_obj, rot_node);
+                qtree_impl_update_node(qtree_obj, rot_node->parent);
+            }
+            rot_node = rot_node->parent;
+            // end of R / LR rotations
+        }
+        else
+        if (rot_node->balance == 2)
+        {
+            qtree_node *sub_node = rot_node->greater;
+            // 0 or 1
+            if (sub_node->balance >= 0)
+            {
+                // rotate L
+                sub_node->parent = rot_node->parent;
+                if (rot_node->parent != NULL)
+                {
+                    if (rot_node->parent->less == rot_node)
+                    {
+                        QTREE_STORE_LINK(qtree_obj, rot_node->parent->less, sub_node);
+                    }
+                    else
+                    {
+                        QTREE_STORE_LINK(qtree_obj, rot_node->parent->greater, sub_node);
+                    }
+                }
+                else
+                {
+                    QTREE_STORE_LINK(qtree_obj, qtree_obj->root, sub_node);
+                }
+
+                QTREE_STORE_LINK(qtree_obj, rot_node->greater, sub_node->less);
+                if (sub_node->less != NULL)
+                {
+                    sub_node->less->parent = rot_node;
+                }
+
+                QTREE_STORE_LINK(qtree_obj, sub_node->less, rot_node);
+                rot_node->parent = sub_node;
+
+                qtree_impl_update_node(qtree_obj, rot_node);
+                qtree_impl_update_node(qtree_obj, sub_node);
+                if (sub_node->balance == 0)
+                {
+                    rot_node->balance = 1;
+                    sub_node->balance = -1;
+                    break;
+                }
+                else
+                {
+                    rot_node->balance = 0;
+                    sub_node->balance = 0;
+                }
+            }
+            else
+            {
+                // rotate RL
+                if (sub_node->less->balance == -1)
+                {
+                    sub_node->balance = 1;
+                    rot_node->balance = 0;
+                }
+                else
+                if (sub_node->less->balance == 1)
+                {
+                    sub_node->balance = 0;
+                    rot_node->balance = -1;
+                }
+                else
+                {
+                    sub_node->balance = 0;
+                    rot_node->balance = 0;
+                }
+                sub_node->less->balance = 0;
+
+                sub_node->parent = sub_node->less;
+                QTREE_STORE_LINK(qtree_obj, sub_node->less, sub_node->less->greater);
+                QTREE_STORE_LINK(qtree_obj, sub_node->parent->greater, sub_node);
+                QTREE_STORE_LINK(qtree_obj, rot_node->greater, sub_node->parent->less);
+                sub_node->parent->parent = rot_node->parent;
+                if (sub_node->less != NULL)
+                {
+                    sub_node->less->parent = sub_node;
+                }
+                if (rot_node->greater != NULL)
+                {
+                    rot_node->greater->parent = rot_node;
+                }
+
+                if (rot_node->parent != NULL)
+                {
+                    if (rot_node->parent->less == rot_node)
+                    {
+                        QTREE_STORE_LINK(qtree_obj, rot_node->parent->less, sub_node->parent);
+                    }
+                    else
+                    {
+                        QTREE_STORE_LINK(qtree_obj, rot_node->parent->greater, sub_node->parent);
+                    }
+                }
+                else
+                {
+                    QTREE_STORE_LINK(qtree_obj, qtree_obj->root, sub_node->parent);
+                }
+
+                rot_node->parent = sub_node->parent;
+                QTREE_STORE_LINK(qtree_obj, sub_node->parent->less, rot_node);
+
+                qtree_impl_update_node(qtree_obj, sub_node);
+                qtree_impl_update_node(qtree_obj, rot_node);
+                qtree_impl_update_node(qtree_obj, rot_node->parent);
+            }
+            rot_node = rot_node->parent;
+            // end of L / RL rotations
+        }
+        rot_node = rot_node->parent;
+    }
+}
+
+
+/**
+ * Rebalances the tree after node insertion
+ *
+ * WARNING! The order of statements, especially assignments, in this function
+ *          is critical for the function's correct operation.
+ *          DO NOT CHANGE THE ORDER OF ANY STATEMENTS.
+ */
+static inline void qtree_impl_rebalance_insert(
+    qtree      *qtree_obj,
+    qtree_node *sub_node,
+    qtree_node *rot_node
+)
+{
+    // update balance and perform rotations
+    do
+    {
+        if (rot_node->less == sub_node)
+        {
+            --(rot_node->balance);
+        }
+        else
+        {
+            ++(rot_node->balance);
+        }
+
+        if (rot_node->balance == 0)
+        {
+            break;
+        }
+        else
+        if (rot_node->balance == -2)
+        {
+            if (sub_node->balance == -1)
+            {
+                // rotate R
+                rot_node->balance = 0;
+                sub_node->balance = 0;
+
+                sub_node->parent = rot_node->parent;
+                if (rot_node->parent != NULL)
+                {
+                    if (rot_node->parent->less == rot_node)
+                    {
+                        QTREE_STORE_LINK(qtree_obj, rot_node->parent->less, sub_node);
+                    }
+                    else
+                    {
+                        QTREE_STORE_LINK(qtree_obj, rot_node->parent->greater, sub_node);
+                    }
+                }
+                else
+                {
+                    QTREE_STORE_LINK(qtree_obj, qtree_obj->root, sub_node);
+                }
+
+                QTREE_STORE_LINK(qtree_obj, rot_node->less, sub_node->greater);
+                if (sub_node->greater != NULL)
+                {
+                    sub_node->greater->parent = rot_node;
+                }
+
+                QTREE_STORE_LINK(qtree_obj, sub_node->greater, rot_node);
+                rot_node->parent = sub_node;
+
+                qtree_impl_update_node(qtree_obj, rot_node);
+                qtree_impl_update_node(qtree_obj, sub_node);
+            }
+            else
+            {
+                // rotate LR
+                if (sub_node->greater->balance == -1)
+                {
+                    sub_node->balance = 0;
+                    rot_node->balance = 1;
+                }
+                else
+                if (sub_node->greater->balance == 1)
+                {
+                    sub_node->balance = -1;
+                    rot_node->balance = 0;
+                }
+                else
+                {
+                    sub_node->balance = 0;
+                    rot_node->balance = 0;
+                }
+                sub_node->greater->balance = 0;
+
+                sub_node->parent = sub_node->greater;
+                QTREE_STORE_LINK(qtree_obj, sub_node->greater, sub_node->greater->less);
+                QTREE_STORE_LINK(qtree_obj, sub_node->parent->less, sub_node);
+                QTREE_STORE_LINK(qtree_obj, rot_node->less, sub_node->parent->greater);
+                sub_node->parent->parent = rot_node->parent;
+                if (sub_node->greater != NULL)
+                {
+                    sub_node->greater->parent = sub_node;
+                }
+                if (rot_node->less != NULL)
+                {
+                    rot_node->less->parent = rot_node;
+                }
+
+                if (rot_node->parent != NULL)
+                {
+                    if (rot_node->parent->less == rot_node)
+                    {
+                        QTREE_STORE_LINK(qtree_obj, rot_node->parent->less, sub_node->parent);
+                    }
+                    else
+                    {
+                        QTREE_STORE_LINK(qtree_obj, rot_node->parent->greater, sub_node->parent);
+                    }
+                }
+                else
+                {
+                    QTREE_STORE_LINK(qtree_obj, qtree_obj->root, sub_node->parent);
+                }
+
+                rot_node->parent = sub_node->parent;
+                QTREE_STORE_LINK(qtree_obj, sub_node->parent->greater, rot_node);
+
+                qtree_impl_update_node(qtree_obj, sub_node);
+                qtree_impl_update_node(qtree_obj, rot_node);
+                qtree_impl_update_node(qtree_obj, rot_node->parent);
+            }
+            break;
+        }
+        else
+        if (rot_node->balance == 2)
+        {
+            if (sub_node->balance == 1)
+            {
+                // rotate L
+                rot_node->balance = 0;
+                sub_node->balance = 0;
+
+                sub_node->parent = rot_node->parent;
+                if (rot_node->parent != NULL)
+                {
+                    if (rot_node->parent->less == rot_node)
+                    {
+                        QTREE_STORE_LINK(qtree_obj, rot_node->parent->less, sub_node);
+                    }
+                    else
+                    {
+                        QTREE_STORE_LINK(qtree_obj, rot_node->parent->greater, sub_node);
+                    }
+                }
+                else
+                {
+                    QTREE_STORE_LINK(qtree_obj, qtree_obj->root, sub_node);
+                }
+
+                QTREE_STORE_LINK(qtree_obj, rot_node->greater, sub_node->less);
+                if (sub_node->less != NULL)
+                {
+                    sub_node->less->parent = rot_node;
+                }
+
+                QTREE_STORE_LINK(qtree_obj, sub_node->less, rot_node);
+                rot_node->parent = sub_node;
+
+                qtree_impl_update_node(qtree_obj, rot_node);
+                qtree_impl_update_node(qtree_obj, sub_node);
+            }
+            else
+            {
+                // rotate RL
+                if (sub_node->less->balance == -1)
+                {
+                    sub_node->balance = 1;
+                    rot_node->balance = 0;
+                }
+                else
+                if (sub_node->less->balance == 1)
+                {
+                    sub_node->balance = 0;
+                    rot_node->balance = -1;
+                }
+                else
+                {
+                    sub_node->balance = 0;
+                    rot_node->balance = 0;
+                }
+                sub_node->less->balance = 0;
+
+                sub_node->parent = sub_node->less;
+                QTREE_STORE_LINK(qtree_obj, sub_node->less, sub_node->less->greater);
+                QTREE_STORE_LINK(qtree_obj, sub_node->parent->greater, sub_node);
+                QTREE_STORE_LINK(qtree_obj, rot_node->greater, sub_node->parent->less);
+                sub_node->parent->parent = rot_node->parent;
+                if (sub_node->less != NULL)
+                {
                     sub_node->less->parent = sub_node;
                 }
                 if (rot_node->greater != NULL)
@@ -506,330 +2471,1779 @@ static inline void qtree_impl_rebalance_remove(
                     rot_node->greater->parent = rot_node;
                 }
 
-                if (rot_node->parent != NULL)
+                if (rot_node->parent != NULL)
+                {
+                    if (rot_node->parent->less == rot_node)
+                    {
+                        QTREE_STORE_LINK(qtree_obj, rot_node->parent->less, sub_node->parent);
+                    }
+                    else
+                    {
+                        QTREE_STORE_LINK(qtree_obj, rot_node->parent->greater, sub_node->parent);
+                    }
+                }
+                else
+                {
+                    QTREE_STORE_LINK(qtree_obj, qtree_obj->root, sub_node->parent);
+                }
+
+                rot_node->parent = sub_node->parent;
+                QTREE_STORE_LINK(qtree_obj, sub_node->parent->less, rot_node);
+
+                qtree_impl_update_node(qtree_obj, sub_node);
+                qtree_impl_update_node(qtree_obj, rot_node);
+                qtree_impl_update_node(qtree_obj, rot_node->parent);
+            }
+            break;
+        }
+
+        sub_node = rot_node;
+        rot_node = rot_node->parent;
+    }
+    while (rot_node != NULL);
+}
+
+
+/**
+ * Inserts an entry by searching for its position in the subtree of start_node
+ *
+ * The key must be within the range of keys covered by the subtree of start_node.
+ * If ins_node_out is not NULL, it is set to the inserted node, or to the node of
+ * the existing entry if the key is a duplicate.
+ */
+static inline qtree_rc qtree_impl_insert(
+    qtree       *qtree_obj,
+    qtree_node  *start_node,
+    const void  *key_ptr,
+    const void  *value_ptr,
+    qtree_node  **ins_node_out
+)
+{
+    qtree_rc rc = QTREE_PASS;
+
+    qtree_node **ref_ins_node = &qtree_obj->root;
+    qtree_node *parent_node = NULL;
+    const uint64_t key_prefix = qtree_impl_prefix(qtree_obj, key_ptr);
+
+    if (start_node != NULL)
+    {
+        ref_ins_node = qtree_obj->qtree_prefix != NULL ?
+            qtree_impl_search_slot(qtree_obj, start_node, key_ptr, key_prefix, &parent_node, true) :
+            qtree_impl_search_slot(qtree_obj, start_node, key_ptr, key_prefix, &parent_node, false);
+        if (ref_ins_node == NULL)
+        {
+            rc = QTREE_ERR_EXISTS;
+            if (ins_node_out != NULL)
+            {
+                *ins_node_out = parent_node;
+            }
+        }
+    }
+
+    if (ref_ins_node != NULL)
+    {
+        qtree_node *ins_node = qtree_impl_alloc_node(qtree_obj);
+        if (ins_node != NULL)
+        {
+            QTREE_STORE_FIELD(qtree_obj, ins_node->key, key_ptr);
+            QTREE_STORE_FIELD(qtree_obj, ins_node->value, value_ptr);
+            qtree_impl_store_prefix(qtree_obj, ins_node, key_prefix);
+            qtree_impl_link_leaf(qtree_obj, ins_node, parent_node, ref_ins_node);
+            if (ins_node_out != NULL)
+            {
+                *ins_node_out = ins_node;
+            }
+        }
+        else
+        {
+            rc = QTREE_ERR_NOMEM;
+        }
+    }
+
+    return rc;
+}
+
+
+static inline qtree_rc qtree_impl_insert_node(qtree *qtree_obj, qtree_node *ins_node)
+{
+    qtree_rc rc = QTREE_PASS;
+
+    qtree_node **ref_ins_node = &qtree_obj->root;
+    qtree_node *parent_node = NULL;
+    const uint64_t key_prefix = qtree_impl_prefix(qtree_obj, ins_node->key);
+
+    if (qtree_obj->root != NULL)
+    {
+        ref_ins_node = qtree_obj->qtree_prefix != NULL ?
+            qtree_impl_search_slot(qtree_obj, qtree_obj->root, ins_node->key, key_prefix, &parent_node, true) :
+            qtree_impl_search_slot(qtree_obj, qtree_obj->root, ins_node->key, key_prefix, &parent_node, false);
+    }
+
+    if (ref_ins_node != NULL)
+    {
+        qtree_impl_store_prefix(qtree_obj, ins_node, key_prefix);
+        qtree_impl_link_leaf(qtree_obj, ins_node, parent_node, ref_ins_node);
+    }
+    else
+    {
+        rc = QTREE_ERR_EXISTS;
+    }
+
+    return rc;
+}
+
+
+/**
+ * Finds the free child slot for a key in the subtree of start_node
+ *
+ * @return reference to the free slot, whose parent is stored in *parent_out,
+ *         or NULL if there is a node with an equal key, which is stored in *parent_out
+ */
+static inline qtree_node **qtree_impl_search_slot(
+    const qtree     *qtree_obj,
+    qtree_node      *start_node,
+    const void      *key,
+    const uint64_t  key_prefix,
+    qtree_node      **parent_out,
+    const bool      use_prefix
+)
+{
+    qtree_node **ref_slot = NULL;
+
+    qtree_node *parent_node = start_node;
+    while (true)
+    {
+        const int cmp_rc = qtree_impl_cmp(qtree_obj, key, key_prefix, parent_node, use_prefix);
+        if (cmp_rc < 0)
+        {
+            if (parent_node->less == NULL)
+            {
+                ref_slot = &parent_node->less;
+                break;
+            }
+            else
+            {
+                parent_node = parent_node->less;
+            }
+        }
+        else
+        if (cmp_rc > 0)
+        {
+            if (parent_node->greater == NULL)
+            {
+                ref_slot = &parent_node->greater;
+                break;
+            }
+            else
+            {
+                parent_node = parent_node->greater;
+            }
+        }
+        else
+        {
+            break;
+        }
+    }
+    *parent_out = parent_node;
+
+    return ref_slot;
+}
+
+
+/**
+ * Links a node with an initialized key, value and prefix into a free child
+ * slot of the parent node, or into the root slot, and rebalances the tree
+ */
+static inline void qtree_impl_link_leaf(
+    qtree       *qtree_obj,
+    qtree_node  *ins_node,
+    qtree_node  *parent_node,
+    qtree_node  **ref_ins_node
+)
+{
+    ins_node->parent  = parent_node;
+    ins_node->less    = NULL;
+    ins_node->greater = NULL;
+    ins_node->balance = 0;
+    // The rotations read the augmented data of the new node
+    qtree_impl_update_node(qtree_obj, ins_node);
+    // The node is initialized before it becomes reachable for concurrent readers
+    QTREE_STORE_LINK(qtree_obj, *ref_ins_node, ins_node);
+    QTREE_STORE_FIELD(qtree_obj, qtree_obj->size, qtree_obj->size + 1);
+    qtree_impl_filter_add(qtree_obj, ins_node->key);
+    const bool less_side = parent_node != NULL && ref_ins_node == &parent_node->less;
+    qtree_impl_thread_node(qtree_obj, ins_node, parent_node, less_side);
+    qtree_impl_insert_bounds(qtree_obj, ins_node, parent_node, less_side);
+    if (parent_node != NULL)
+    {
+        qtree_impl_rebalance_insert(qtree_obj, ins_node, parent_node);
+    }
+    qtree_impl_update_path(qtree_obj, ins_node);
+}
+
+
+static inline void qtree_impl_remove_node(qtree *qtree_obj, qtree_node *crt)
+{
+    qtree_impl_unlink_node(qtree_obj, crt);
+    qtree_impl_free_node(qtree_obj, crt);
+}
+
+
+static inline qtree_rc qtree_impl_alloc_sorted(
+    qtree       *qtree_obj,
+    const void  *keys[],
+    const void  *values[],
+    const size_t count,
+    qtree_node  **node_list
+)
+{
+    qtree_rc rc = QTREE_PASS;
+
+    size_t idx = 0;
+    while (idx < count)
+    {
+        qtree_node *node = qtree_impl_alloc_node(qtree_obj);
+        if (node == NULL)
+        {
+            rc = QTREE_ERR_NOMEM;
+            break;
+        }
+        node->key   = keys[idx];
+        node->value = values != NULL ? values[idx] : NULL;
+        qtree_impl_store_prefix(qtree_obj, node, qtree_impl_prefix(qtree_obj, keys[idx]));
+        node_list[idx] = node;
+        ++idx;
+    }
+
+    if (rc != QTREE_PASS)
+    {
+        while (idx > 0)
+        {
+            --idx;
+            qtree_impl_free_node(qtree_obj, node_list[idx]);
+        }
+    }
+
+    return rc;
+}
+
+
+/**
+ * Links the sorted list of nodes into a balanced subtree
+ *
+ * The middle node becomes the subtree's root, so the less subtree is never
+ * lower than the greater subtree and each balance is either -1 or 0.
+ *
+ * @return height of the subtree
+ */
+static int qtree_impl_link_sorted(
+    const qtree *qtree_obj,
+    qtree_node  *const *node_list,
+    const size_t count,
+    qtree_node  *parent_node,
+    qtree_node  **ref_sub_root
+)
+{
+    int height = 0;
+
+    if (count > 0)
+    {
+        const size_t mid_idx = count / 2;
+        qtree_node *node = node_list[mid_idx];
+        *ref_sub_root = node;
+        node->parent  = parent_node;
+
+        const int less_height = qtree_impl_link_sorted(
+            qtree_obj, node_list, mid_idx, node, &node->less
+        );
+        const int greater_height = qtree_impl_link_sorted(
+            qtree_obj, &(node_list[mid_idx + 1]), count - mid_idx - 1, node, &node->greater
+        );
+        node->balance = greater_height - less_height;
+        qtree_impl_update_node(qtree_obj, node);
+        height = less_height + 1;
+    }
+    else
+    {
+        *ref_sub_root = NULL;
+    }
+
+    return height;
+}
+
+
+/**
+ * Links a node that was inserted as a leaf to its in-order neighbors
+ */
+static inline void qtree_impl_thread_node(
+    const qtree *qtree_obj,
+    qtree_node  *ins_node,
+    qtree_node  *parent_node,
+    const bool  less_side
+)
+{
+    if ((qtree_obj->options & QTREE_OPT_THREADED) != 0)
+    {
+        const size_t links_offset = qtree_obj->links_offset;
+        qtree_links *ins_links = &QTREE_LINKS(links_offset, ins_node);
+        if (parent_node == NULL)
+        {
+            ins_links->prev = NULL;
+            ins_links->next = NULL;
+        }
+        else
+        if (less_side)
+        {
+            ins_links->prev = QTREE_LINKS(links_offset, parent_node).prev;
+            ins_links->next = parent_node;
+        }
+        else
+        {
+            ins_links->prev = parent_node;
+            ins_links->next = QTREE_LINKS(links_offset, parent_node).next;
+        }
+
+        if (ins_links->prev != NULL)
+        {
+            QTREE_LINKS(links_offset, ins_links->prev).next = ins_node;
+        }
+        if (ins_links->next != NULL)
+        {
+            QTREE_LINKS(links_offset, ins_links->next).prev = ins_node;
+        }
+    }
+}
+
+
+/**
+ * Links the nodes of a sorted list to their neighbors in the list
+ */
+static inline void qtree_impl_thread_list(
+    const qtree         *qtree_obj,
+    qtree_node  *const  *node_list,
+    const size_t        count
+)
+{
+    if ((qtree_obj->options & QTREE_OPT_THREADED) != 0)
+    {
+        for (size_t idx = 0; idx < count; ++idx)
+        {
+            qtree_links *links = &QTREE_LINKS(qtree_obj->links_offset, node_list[idx]);
+            links->prev = idx > 0 ? node_list[idx - 1] : NULL;
+            links->next = idx + 1 < count ? node_list[idx + 1] : NULL;
+        }
+    }
+}
+
+
+/**
+ * Relinks all nodes of the tree into a balanced tree of minimal height in O(n)
+ */
+static inline qtree_rc qtree_impl_rebuild_balanced(qtree *qtree_obj)
+{
+    qtree_rc rc = QTREE_PASS;
+
+    const size_t count = qtree_obj->size;
+    qtree_node **node_list = NULL;
+    if (count <= ((size_t) ~0) / sizeof (qtree_node *))
+    {
+        node_list = malloc(count * sizeof (qtree_node *));
+    }
+    if (node_list != NULL)
+    {
+        qtree_node *node = qtree_obj->min_node;
+        for (size_t idx = 0; idx < count; ++idx)
+        {
+            node_list[idx] = node;
+            node = qtree_impl_successor(node);
+        }
+        qtree_impl_link_sorted(qtree_obj, node_list, count, NULL, &qtree_obj->root);
+        free(node_list);
+    }
+    else
+    {
+        rc = QTREE_ERR_NOMEM;
+    }
+
+    return rc;
+}
+
+
+/**
+ * Moves all nodes of an arena tree into a new slab in breadth-first order
+ *
+ * The slabs that held the originals are released at the end. The threaded
+ * in-order links and the least and greatest nodes are determined anew.
+ */
+static inline qtree_rc qtree_impl_relocate(qtree *qtree_obj)
+{
+    qtree_rc rc = QTREE_PASS;
+
+    const size_t count = qtree_obj->size;
+    const size_t node_size = qtree_obj->node_size;
+    qtree_slab *slab = NULL;
+    if (count <= (((size_t) ~0) - sizeof (qtree_slab)) / node_size)
+    {
+        slab = malloc(sizeof (qtree_slab) + count * node_size);
+    }
+    if (slab != NULL)
+    {
+        slab->capacity = count;
+
+        qtree_obj->root = qtree_impl_copy_subtree(qtree_obj, slab, qtree_obj->root, NULL);
+        qtree_impl_update_bounds(qtree_obj);
+        qtree_impl_thread_tree(qtree_obj);
+
+        qtree_slab *old_slab = qtree_obj->slab_list;
+        while (old_slab != NULL)
+        {
+            qtree_slab *next_slab = old_slab->next;
+            free(old_slab);
+            old_slab = next_slab;
+        }
+        slab->next            = NULL;
+        qtree_obj->slab_list  = slab;
+        qtree_obj->free_list  = NULL;
+        qtree_obj->slab_avail = 0;
+    }
+    else
+    {
+        rc = QTREE_ERR_NOMEM;
+    }
+
+    return rc;
+}
+
+
+/**
+ * Copies all nodes of a subtree into a slab with room for them in breadth-first order
+ *
+ * The slab is used as the queue of the breadth-first traversal. The original of
+ * each node is not accessed anymore once it has been copied, so it is returned
+ * to the arena of the owner tree right away, if any.
+ *
+ * @return root of the copied subtree
+ */
+static inline qtree_node *qtree_impl_copy_subtree(
+    const qtree *qtree_obj,
+    qtree_slab  *slab,
+    qtree_node  *sub_root,
+    qtree       *owner_obj
+)
+{
+    const size_t node_size = qtree_obj->node_size;
+
+    qtree_node *root_node = qtree_impl_slab_node(qtree_obj, slab, 0);
+    memcpy(root_node, sub_root, node_size);
+    root_node->parent = NULL;
+    if (owner_obj != NULL)
+    {
+        qtree_impl_free_node(owner_obj, sub_root);
+    }
+    size_t tail_idx = 1;
+    for (size_t head_idx = 0; head_idx < tail_idx; ++head_idx)
+    {
+        qtree_node *node = qtree_impl_slab_node(qtree_obj, slab, head_idx);
+        if (node->less != NULL)
+        {
+            qtree_node *sub_node = qtree_impl_slab_node(qtree_obj, slab, tail_idx);
+            memcpy(sub_node, node->less, node_size);
+            if (owner_obj != NULL)
+            {
+                qtree_impl_free_node(owner_obj, node->less);
+            }
+            sub_node->parent = node;
+            node->less = sub_node;
+            ++tail_idx;
+        }
+        if (node->greater != NULL)
+        {
+            qtree_node *sub_node = qtree_impl_slab_node(qtree_obj, slab, tail_idx);
+            memcpy(sub_node, node->greater, node_size);
+            if (owner_obj != NULL)
+            {
+                qtree_impl_free_node(owner_obj, node->greater);
+            }
+            sub_node->parent = node;
+            node->greater = sub_node;
+            ++tail_idx;
+        }
+    }
+
+    return root_node;
+}
+
+
+/**
+ * Relinks all nodes of the tree to their in-order neighbors in O(n)
+ */
+static inline void qtree_impl_thread_tree(const qtree *qtree_obj)
+{
+    if ((qtree_obj->options & QTREE_OPT_THREADED) != 0)
+    {
+        const size_t links_offset = qtree_obj->links_offset;
+        qtree_it iter;
+        iter.next         = qtree_obj->root;
+        iter.end          = NULL;
+        iter.links_offset = 0;
+        while (iter.next != NULL && iter.next->less != NULL)
+        {
+            iter.next = iter.next->less;
+        }
+
+        qtree_node *prev_node = NULL;
+        qtree_node *node = qtree_next(&iter);
+        while (node != NULL)
+        {
+            QTREE_LINKS(links_offset, node).prev = prev_node;
+            if (prev_node != NULL)
+            {
+                QTREE_LINKS(links_offset, prev_node).next = node;
+            }
+            prev_node = node;
+            node = qtree_next(&iter);
+        }
+        if (prev_node != NULL)
+        {
+            QTREE_LINKS(links_offset, prev_node).next = NULL;
+        }
+    }
+}
+
+
+/**
+ * Updates the cached least and greatest nodes after inserting a leaf node
+ */
+static inline void qtree_impl_insert_bounds(
+    qtree       *qtree_obj,
+    qtree_node  *ins_node,
+    qtree_node  *parent_node,
+    const bool  less_side
+)
+{
+    if (parent_node == NULL)
+    {
+        qtree_obj->min_node = ins_node;
+        qtree_obj->max_node = ins_node;
+    }
+    else
+    if (less_side)
+    {
+        if (qtree_obj->min_node == parent_node)
+        {
+            qtree_obj->min_node = ins_node;
+        }
+    }
+    else
+    if (qtree_obj->max_node == parent_node)
+    {
+        qtree_obj->max_node = ins_node;
+    }
+}
+
+
+/**
+ * Finds the least and greatest nodes of a tree that was restructured
+ */
+static inline void qtree_impl_update_bounds(qtree *qtree_obj)
+{
+    qtree_node *min_node = qtree_obj->root;
+    qtree_node *max_node = qtree_obj->root;
+    if (qtree_obj->root != NULL)
+    {
+        while (min_node->less != NULL)
+        {
+            min_node = min_node->less;
+        }
+        while (max_node->greater != NULL)
+        {
+            max_node = max_node->greater;
+        }
+    }
+    qtree_obj->min_node = min_node;
+    qtree_obj->max_node = max_node;
+}
+
+
+/**
+ * Recalculates the augmented data of a node from the node's children
+ */
+static inline void qtree_impl_update_node(const qtree *qtree_obj, qtree_node *node)
+{
+    if ((qtree_obj->options & QTREE_OPT_ORDER_STATS) != 0)
+    {
+        QTREE_COUNT(qtree_obj, node) =
+            qtree_impl_count(qtree_obj, node->less) + qtree_impl_count(qtree_obj, node->greater) + 1;
+    }
+    if ((qtree_obj->options & QTREE_OPT_INTERVAL) != 0)
+    {
+        const void *max_end = qtree_obj->qtree_end(node->key, node->value);
+        if (node->less != NULL && qtree_obj->qtree_cmp(QTREE_MAX_END(qtree_obj, node->less), max_end) > 0)
+        {
+            max_end = QTREE_MAX_END(qtree_obj, node->less);
+        }
+        if (node->greater != NULL && qtree_obj->qtree_cmp(QTREE_MAX_END(qtree_obj, node->greater), max_end) > 0)
+        {
+            max_end = QTREE_MAX_END(qtree_obj, node->greater);
+        }
+        QTREE_MAX_END(qtree_obj, node) = max_end;
+    }
+    if ((qtree_obj->options & QTREE_OPT_AGGREGATE) != 0)
+    {
+        QTREE_AGGREGATE(qtree_obj, node) = qtree_obj->aggr_combine(
+            qtree_obj->aggr_combine(
+                qtree_impl_aggregate(qtree_obj, node->less),
+                qtree_obj->aggr_map(node->key, node->value)
+            ),
+            qtree_impl_aggregate(qtree_obj, node->greater)
+        );
+    }
+}
+
+
+/**
+ * Recalculates the augmented data of a node and of all its ancestors
+ */
+static inline void qtree_impl_update_path(const qtree *qtree_obj, qtree_node *node)
+{
+    if ((qtree_obj->options & QTREE_AUGMENT_OPTIONS) != 0)
+    {
+        while (node != NULL)
+        {
+            qtree_impl_update_node(qtree_obj, node);
+            node = node->parent;
+        }
+    }
+}
+
+
+static inline qtree_aggr qtree_impl_aggregate(const qtree *qtree_obj, const qtree_node *node)
+{
+    return node != NULL ? QTREE_AGGREGATE(qtree_obj, node) : qtree_obj->aggr_identity;
+}
+
+
+static inline size_t qtree_impl_count(const qtree *qtree_obj, const qtree_node *node)
+{
+    return node != NULL ? QTREE_COUNT(qtree_obj, node) : 0;
+}
+
+
+/**
+ * @return number of keys less than the specified key, or if inclusive is set,
+ *         number of keys less than or equal to the specified key
+ */
+static inline size_t qtree_impl_rank(const qtree *qtree_obj, const void *key, const bool inclusive)
+{
+    return qtree_obj->qtree_prefix != NULL ?
+        qtree_impl_search_rank(qtree_obj, key, inclusive, true) :
+        qtree_impl_search_rank(qtree_obj, key, inclusive, false);
+}
+
+
+static inline size_t qtree_impl_search_rank(
+    const qtree *qtree_obj,
+    const void  *key,
+    const bool  inclusive,
+    const bool  use_prefix
+)
+{
+    size_t rank = 0;
+
+    const uint64_t key_prefix = use_prefix ? qtree_obj->qtree_prefix(key) : 0;
+    const qtree_node *node = qtree_obj->root;
+    while (node != NULL)
+    {
+        const int cmp_rc = qtree_impl_cmp(qtree_obj, key, key_prefix, node, use_prefix);
+        if (cmp_rc < 0)
+        {
+            node = node->less;
+        }
+        else
+        if (cmp_rc > 0)
+        {
+            rank += qtree_impl_count(qtree_obj, node->less) + 1;
+            node = node->greater;
+        }
+        else
+        {
+            rank += qtree_impl_count(qtree_obj, node->less);
+            if (inclusive)
+            {
+                ++rank;
+            }
+            break;
+        }
+    }
+
+    return rank;
+}
+
+
+/**
+ * @return height of the subtree, determined by following the higher child of each node
+ */
+static inline int qtree_impl_height(const qtree_node *node)
+{
+    int height = 0;
+    while (node != NULL)
+    {
+        ++height;
+        node = node->balance < 0 ? node->less : node->greater;
+    }
+    return height;
+}
+
+
+static inline int qtree_impl_less_height(const qtree_node *node, const int height)
+{
+    return node->balance > 0 ? height - 2 : height - 1;
+}
+
+
+static inline int qtree_impl_greater_height(const qtree_node *node, const int height)
+{
+    return node->balance < 0 ? height - 2 : height - 1;
+}
+
+
+/**
+ * Rotates the greater child of a node into the node's position
+ *
+ * Unlike the rotations in the rebalance functions, any valid balance of the
+ * two nodes is supported. If the node is a root node, the caller must update
+ * the reference to the root node.
+ *
+ * @return node that took the rotated node's position
+ */
+static inline qtree_node *qtree_impl_rotate_left(const qtree *qtree_obj, qtree_node *rot_node)
+{
+    qtree_node *sub_node = rot_node->greater;
+
+    rot_node->greater = sub_node->less;
+    if (sub_node->less != NULL)
+    {
+        sub_node->less->parent = rot_node;
+    }
+    sub_node->parent = rot_node->parent;
+    if (rot_node->parent != NULL)
+    {
+        if (rot_node->parent->less == rot_node)
+        {
+            rot_node->parent->less = sub_node;
+        }
+        else
+        {
+            rot_node->parent->greater = sub_node;
+        }
+    }
+    sub_node->less   = rot_node;
+    rot_node->parent = sub_node;
+
+    rot_node->balance -= 1 + (sub_node->balance > 0 ? sub_node->balance : 0);
+    sub_node->balance -= 1 - (rot_node->balance < 0 ? rot_node->balance : 0);
+
+    qtree_impl_update_node(qtree_obj, rot_node);
+    qtree_impl_update_node(qtree_obj, sub_node);
+
+    return sub_node;
+}
+
+
+/**
+ * Rotates the less child of a node into the node's position
+ *
+ * @see qtree_impl_rotate_left
+ */
+static inline qtree_node *qtree_impl_rotate_right(const qtree *qtree_obj, qtree_node *rot_node)
+{
+    qtree_node *sub_node = rot_node->less;
+
+    rot_node->less = sub_node->greater;
+    if (sub_node->greater != NULL)
+    {
+        sub_node->greater->parent = rot_node;
+    }
+    sub_node->parent = rot_node->parent;
+    if (rot_node->parent != NULL)
+    {
+        if (rot_node->parent->less == rot_node)
+        {
+            rot_node->parent->less = sub_node;
+        }
+        else
+        {
+            rot_node->parent->greater = sub_node;
+        }
+    }
+    sub_node->greater = rot_node;
+    rot_node->parent  = sub_node;
+
+    rot_node->balance += 1 - (sub_node->balance < 0 ? sub_node->balance : 0);
+    sub_node->balance += 1 + (rot_node->balance > 0 ? rot_node->balance : 0);
+
+    qtree_impl_update_node(qtree_obj, rot_node);
+    qtree_impl_update_node(qtree_obj, sub_node);
+
+    return sub_node;
+}
+
+
+/**
+ * Joins two subtrees and a node into a balanced subtree
+ *
+ * All keys in the less subtree must be less than the key of the join node, and all keys
+ * in the greater subtree must be greater than the key of the join node. The roots of
+ * the subtrees must not have a parent. The join node is attached to the higher subtree
+ * where the other subtree's height is reached, followed by the same kind of rebalancing
+ * as after an insertion, which takes O(|less_height - greater_height| + 1).
+ *
+ * @return root of the joined subtree
+ */
+static qtree_node *qtree_impl_join(
+    const qtree *qtree_obj,
+    qtree_node  *less_root,
+    const int   less_height,
+    qtree_node  *join_node,
+    qtree_node  *greater_root,
+    const int   greater_height,
+    int         *join_height
+)
+{
+    qtree_node *root = NULL;
+
+    if (less_height > greater_height + 1 || greater_height > less_height + 1)
+    {
+        const qtree_dir dir = less_height > greater_height ? QTREE_DIR_LESS : QTREE_DIR_GREATER;
+        const int low_height = dir == QTREE_DIR_LESS ? greater_height : less_height;
+
+        // descend along the inner edge of the higher subtree
+        root = dir == QTREE_DIR_LESS ? less_root : greater_root;
+        qtree_node *parent_node = NULL;
+        qtree_node *node = root;
+        int height = dir == QTREE_DIR_LESS ? less_height : greater_height;
+        while (height > low_height + 1)
+        {
+            parent_node = node;
+            if (dir == QTREE_DIR_LESS)
+            {
+                height = qtree_impl_greater_height(node, height);
+                node   = node->greater;
+            }
+            else
+            {
+                height = qtree_impl_less_height(node, height);
+                node   = node->less;
+            }
+        }
+
+        join_node->parent = parent_node;
+        if (dir == QTREE_DIR_LESS)
+        {
+            join_node->less       = node;
+            join_node->greater    = greater_root;
+            join_node->balance    = greater_height - height;
+            parent_node->greater  = join_node;
+        }
+        else
+        {
+            join_node->less       = less_root;
+            join_node->greater    = node;
+            join_node->balance    = height - less_height;
+            parent_node->less     = join_node;
+        }
+        if (join_node->less != NULL)
+        {
+            join_node->less->parent = join_node;
+        }
+        if (join_node->greater != NULL)
+        {
+            join_node->greater->parent = join_node;
+        }
+        qtree_impl_update_node(qtree_obj, join_node);
+
+        // The subtree at the join node is higher than the subtree it replaced,
+        // rebalance upwards until the height of a subtree remains unchanged
+        bool grown = true;
+        qtree_node *rot_node = parent_node;
+        while (rot_node != NULL && grown)
+        {
+            qtree_node *top_node = rot_node;
+            if (dir == QTREE_DIR_LESS)
+            {
+                ++(rot_node->balance);
+                if (rot_node->balance == 2)
                 {
-                    if (rot_node->parent->less == rot_node)
+                    if (rot_node->greater->balance < 0)
                     {
-                        rot_node->parent->less = sub_node->parent;
+                        qtree_impl_rotate_right(qtree_obj, rot_node->greater);
                     }
-                    else
+                    top_node = qtree_impl_rotate_left(qtree_obj, rot_node);
+                }
+            }
+            else
+            {
+                --(rot_node->balance);
+                if (rot_node->balance == -2)
+                {
+                    if (rot_node->less->balance > 0)
                     {
-                        rot_node->parent->greater = sub_node->parent;
+                        qtree_impl_rotate_left(qtree_obj, rot_node->less);
                     }
+                    top_node = qtree_impl_rotate_right(qtree_obj, rot_node);
+                }
+            }
+            grown = top_node->balance != 0;
+            if (top_node->parent == NULL)
+            {
+                root = top_node;
+            }
+            rot_node = top_node->parent;
+        }
+        qtree_impl_update_path(qtree_obj, join_node);
+
+        *join_height = (dir == QTREE_DIR_LESS ? less_height : greater_height) + (grown ? 1 : 0);
+    }
+    else
+    {
+        join_node->parent  = NULL;
+        join_node->less    = less_root;
+        join_node->greater = greater_root;
+        join_node->balance = greater_height - less_height;
+        if (less_root != NULL)
+        {
+            less_root->parent = join_node;
+        }
+        if (greater_root != NULL)
+        {
+            greater_root->parent = join_node;
+        }
+        qtree_impl_update_node(qtree_obj, join_node);
+        root = join_node;
+
+        *join_height = (less_height > greater_height ? less_height : greater_height) + 1;
+    }
+
+    return root;
+}
+
+
+/**
+ * Joins two subtrees into a balanced subtree
+ *
+ * All keys in the less subtree must be less than all keys in the greater subtree.
+ *
+ * @return root of the joined subtree
+ */
+static qtree_node *qtree_impl_join2(
+    const qtree *qtree_obj,
+    qtree_node  *less_root,
+    const int   less_height,
+    qtree_node  *greater_root,
+    const int   greater_height,
+    int         *join_height
+)
+{
+    qtree_node *root = NULL;
+
+    if (less_root == NULL)
+    {
+        root         = greater_root;
+        *join_height = greater_height;
+    }
+    else
+    if (greater_root == NULL)
+    {
+        root         = less_root;
+        *join_height = less_height;
+    }
+    else
+    {
+        // The greatest node of the less subtree joins the remainder of
+        // the less subtree and the greater subtree
+        qtree_node *max_node = less_root;
+        while (max_node->greater != NULL)
+        {
+            max_node = max_node->greater;
+        }
+
+        // The node keeps its position in the order of keys, so it remains threaded
+        qtree sub_tree;
+        qtree_impl_init_like(&sub_tree, qtree_obj);
+        sub_tree.options &= ~((unsigned int) (QTREE_OPT_ARENA | QTREE_OPT_THREADED));
+        sub_tree.root = less_root;
+        sub_tree.size = 1;
+        qtree_impl_unlink_node(&sub_tree, max_node);
+
+        root = qtree_impl_join(
+            qtree_obj, sub_tree.root, qtree_impl_height(sub_tree.root),
+            max_node, greater_root, greater_height, join_height
+        );
+    }
+
+    return root;
+}
+
+
+/**
+ * Splits a subtree into the nodes with keys less than and greater than the specified key
+ *
+ * Takes O(log n) in total, because the heights of the joined subtrees increase
+ * along the path from the node with the key to the root.
+ *
+ * @return detached node with the specified key, or NULL if there is no such node
+ */
+static qtree_node *qtree_impl_split(
+    const qtree *qtree_obj,
+    qtree_node  *root,
+    const int   height,
+    const void  *key,
+    qtree_node  **less_root,
+    int         *less_height,
+    qtree_node  **greater_root,
+    int         *greater_height
+)
+{
+    qtree_node *key_node = NULL;
+
+    if (root == NULL)
+    {
+        *less_root      = NULL;
+        *less_height    = 0;
+        *greater_root   = NULL;
+        *greater_height = 0;
+    }
+    else
+    {
+        qtree_node *less_sub    = root->less;
+        qtree_node *greater_sub = root->greater;
+        const int less_sub_height    = qtree_impl_less_height(root, height);
+        const int greater_sub_height = qtree_impl_greater_height(root, height);
+        if (less_sub != NULL)
+        {
+            less_sub->parent = NULL;
+        }
+        if (greater_sub != NULL)
+        {
+            greater_sub->parent = NULL;
+        }
+
+        const int cmp_rc = qtree_obj->qtree_cmp(key, root->key);
+        if (cmp_rc < 0)
+        {
+            qtree_node *mid_root = NULL;
+            int mid_height = 0;
+            key_node = qtree_impl_split(
+                qtree_obj, less_sub, less_sub_height, key,
+                less_root, less_height, &mid_root, &mid_height
+            );
+            *greater_root = qtree_impl_join(
+                qtree_obj, mid_root, mid_height, root, greater_sub, greater_sub_height, greater_height
+            );
+        }
+        else
+        if (cmp_rc > 0)
+        {
+            qtree_node *mid_root = NULL;
+            int mid_height = 0;
+            key_node = qtree_impl_split(
+                qtree_obj, greater_sub, greater_sub_height, key,
+                &mid_root, &mid_height, greater_root, greater_height
+            );
+            *less_root = qtree_impl_join(
+                qtree_obj, less_sub, less_sub_height, root, mid_root, mid_height, less_height
+            );
+        }
+        else
+        {
+            key_node          = root;
+            key_node->less    = NULL;
+            key_node->greater = NULL;
+            key_node->balance = 0;
+            *less_root        = less_sub;
+            *less_height      = less_sub_height;
+            *greater_root     = greater_sub;
+            *greater_height   = greater_sub_height;
+        }
+    }
+
+    return key_node;
+}
+
+
+/**
+ * Counts the nodes of two subtrees with a known total number of nodes by
+ * iterating both subtrees alternately until the smaller one is exhausted
+ *
+ * @return number of nodes in the less subtree
+ */
+static inline size_t qtree_impl_count_less(
+    qtree_node      *less_root,
+    qtree_node      *greater_root,
+    const size_t    total
+)
+{
+    qtree_it less_iter;
+    less_iter.next         = less_root;
+    less_iter.end          = NULL;
+    less_iter.links_offset = 0;
+    while (less_iter.next != NULL && less_iter.next->less != NULL)
+    {
+        less_iter.next = less_iter.next->less;
+    }
+
+    qtree_it greater_iter;
+    greater_iter.next         = greater_root;
+    greater_iter.end          = NULL;
+    greater_iter.links_offset = 0;
+    while (greater_iter.next != NULL && greater_iter.next->less != NULL)
+    {
+        greater_iter.next = greater_iter.next->less;
+    }
+
+    size_t count = 0;
+    while (true)
+    {
+        if (qtree_next(&less_iter) == NULL)
+        {
+            break;
+        }
+        if (qtree_next(&greater_iter) == NULL)
+        {
+            count = total - count;
+            break;
+        }
+        ++count;
+    }
+
+    return count;
+}
+
+
+/**
+ * Checks whether the nodes of two trees are ordered, augmented and laid out alike
+ */
+static inline bool qtree_impl_same_layout(const qtree *qtree_obj, const qtree *other_obj)
+{
+    return qtree_obj->qtree_cmp         == other_obj->qtree_cmp
+        && qtree_obj->qtree_prefix      == other_obj->qtree_prefix
+        && qtree_obj->qtree_end         == other_obj->qtree_end
+        && qtree_obj->aggr_map          == other_obj->aggr_map
+        && qtree_obj->aggr_combine      == other_obj->aggr_combine
+        && qtree_obj->aggr_identity.u64 == other_obj->aggr_identity.u64
+        && qtree_obj->options           == other_obj->options
+        && qtree_obj->node_size         == other_obj->node_size;
+}
+
+
+/**
+ * Passes the slabs and the unused nodes of an arena tree on to another arena tree
+ *
+ * The slabs of src follow the first slab of dst, which keeps providing the
+ * unused nodes at its end, so the unused nodes at the end of the first slab of
+ * src are added to the free list of dst instead, as are the nodes on the free
+ * list of src.
+ */
+static inline void qtree_impl_merge_arena(qtree *dst, qtree *src)
+{
+    if (dst->slab_list == NULL)
+    {
+        dst->slab_list  = src->slab_list;
+        dst->slab_avail = src->slab_avail;
+    }
+    else
+    if (src->slab_list != NULL)
+    {
+        qtree_slab *src_slab = src->slab_list;
+        for (size_t idx = src_slab->capacity - src->slab_avail; idx < src_slab->capacity; ++idx)
+        {
+            qtree_impl_free_node(dst, qtree_impl_slab_node(dst, src_slab, idx));
+        }
+        while (src_slab->next != NULL)
+        {
+            src_slab = src_slab->next;
+        }
+        src_slab->next       = dst->slab_list->next;
+        dst->slab_list->next = src->slab_list;
+    }
+
+    qtree_node *node = src->free_list;
+    while (node != NULL)
+    {
+        qtree_node *next_node = node->less;
+        qtree_impl_free_node(dst, node);
+        node = next_node;
+    }
+
+    src->slab_list  = NULL;
+    src->free_list  = NULL;
+    src->slab_avail = 0;
+}
+
+
+/**
+ * Applies a set operation to a subtree of the destination tree and a subtree of
+ * the source tree
+ *
+ * The destination subtree is split at the key of the source subtree's root, the
+ * operation is applied to the resulting pairs of less and greater subtrees,
+ * possibly by another thread, and the results are joined again.
+ * Nodes removed from the trees are collected in the task's drop list.
+ */
+static void qtree_impl_set_op(qtree_set_task *task)
+{
+    qtree_node *dst_root = task->dst_root;
+    qtree_node *src_root = task->src_root;
+
+    if (dst_root == NULL)
+    {
+        if (task->set_op == QTREE_SET_UNION)
+        {
+            task->dst_root   = src_root;
+            task->dst_height = task->src_height;
+        }
+    }
+    else
+    if (src_root == NULL)
+    {
+        if (task->set_op == QTREE_SET_INTERSECTION)
+        {
+            qtree_impl_set_drop_subtree(task, dst_root);
+            task->dst_root   = NULL;
+            task->dst_height = 0;
+        }
+    }
+    else
+    {
+        qtree_set_task less_task    = *task;
+        qtree_set_task greater_task = *task;
+        less_task.drop_head     = NULL;
+        less_task.drop_tail     = NULL;
+        less_task.drop_count    = 0;
+        greater_task.drop_head  = NULL;
+        greater_task.drop_tail  = NULL;
+        greater_task.drop_count = 0;
+
+        less_task.src_root       = src_root->less;
+        less_task.src_height     = qtree_impl_less_height(src_root, task->src_height);
+        greater_task.src_root    = src_root->greater;
+        greater_task.src_height  = qtree_impl_greater_height(src_root, task->src_height);
+        if (task->set_op == QTREE_SET_UNION)
+        {
+            // The source tree is consumed, the source subtrees are detached
+            if (src_root->less != NULL)
+            {
+                src_root->less->parent = NULL;
+            }
+            if (src_root->greater != NULL)
+            {
+                src_root->greater->parent = NULL;
+            }
+        }
+
+        qtree_node *key_node = qtree_impl_split(
+            task->qtree_obj, dst_root, task->dst_height, src_root->key,
+            &less_task.dst_root, &less_task.dst_height,
+            &greater_task.dst_root, &greater_task.dst_height
+        );
+
+        if (task->thread_count > 1 && task->dst_height >= QTREE_PARALLEL_MIN_HEIGHT)
+        {
+            less_task.thread_count    = task->thread_count / 2;
+            greater_task.thread_count = task->thread_count - less_task.thread_count;
+
+            pthread_t less_thread;
+            const bool spawned = pthread_create(
+                &less_thread, NULL, qtree_impl_set_op_thread, &less_task
+            ) == 0;
+            if (!spawned)
+            {
+                qtree_impl_set_op(&less_task);
+            }
+            qtree_impl_set_op(&greater_task);
+            if (spawned)
+            {
+                pthread_join(less_thread, NULL);
+            }
+        }
+        else
+        {
+            qtree_impl_set_op(&less_task);
+            qtree_impl_set_op(&greater_task);
+        }
+
+        qtree_node *join_node = NULL;
+        if (task->set_op == QTREE_SET_UNION)
+        {
+            if (key_node != NULL)
+            {
+                qtree_impl_set_drop(task, src_root);
+                join_node = key_node;
+            }
+            else
+            {
+                join_node = src_root;
+            }
+        }
+        else
+        if (task->set_op == QTREE_SET_INTERSECTION)
+        {
+            join_node = key_node;
+        }
+        else
+        if (key_node != NULL)
+        {
+            qtree_impl_set_drop(task, key_node);
+        }
+
+        if (join_node != NULL)
+        {
+            task->dst_root = qtree_impl_join(
+                task->qtree_obj, less_task.dst_root, less_task.dst_height,
+                join_node, greater_task.dst_root, greater_task.dst_height, &task->dst_height
+            );
+        }
+        else
+        {
+            task->dst_root = qtree_impl_join2(
+                task->qtree_obj, less_task.dst_root, less_task.dst_height,
+                greater_task.dst_root, greater_task.dst_height, &task->dst_height
+            );
+        }
+
+        qtree_impl_set_merge_drops(task, &less_task);
+        qtree_impl_set_merge_drops(task, &greater_task);
+    }
+}
+
+
+static void *qtree_impl_set_op_thread(void *task)
+{
+    qtree_impl_set_op(task);
+    return NULL;
+}
+
+
+static inline qtree_rc qtree_impl_set_run(
+    qtree                   *dst,
+    qtree                   *src,
+    const qtree_set_op      set_op,
+    const size_t            thread_count,
+    const qtree_visit_func  visitor,
+    void                    *context
+)
+{
+    qtree_rc rc = QTREE_PASS;
+
+    if (set_op != QTREE_SET_UNION || qtree_impl_same_layout(dst, src))
+    {
+        qtree_set_task task;
+        task.qtree_obj    = dst;
+        task.set_op       = set_op;
+        task.dst_root     = dst->root;
+        task.dst_height   = qtree_impl_height(dst->root);
+        task.src_root     = src->root;
+        task.src_height   = qtree_impl_height(src->root);
+        task.thread_count = thread_count;
+        task.drop_head    = NULL;
+        task.drop_tail    = NULL;
+        task.drop_count   = 0;
+
+        if (set_op == QTREE_SET_UNION)
+        {
+            if (src->root != NULL)
+            {
+                qtree_impl_filter_invalidate(dst);
+                qtree_impl_filter_invalidate(src);
+            }
+            if ((dst->options & QTREE_OPT_ARENA) != 0)
+            {
+                qtree_impl_merge_arena(dst, src);
+            }
+        }
+
+        qtree_impl_set_op(&task);
+
+        dst->root = task.dst_root;
+        if (set_op == QTREE_SET_UNION)
+        {
+            dst->size += src->size;
+            src->root     = NULL;
+            src->min_node = NULL;
+            src->max_node = NULL;
+            src->size     = 0;
+        }
+        dst->size -= task.drop_count;
+        qtree_impl_update_bounds(dst);
+        // The nodes of both trees are interleaved, so the threads are rebuilt in O(n)
+        qtree_impl_thread_tree(dst);
+
+        // Dropped nodes are released only after all threads have finished;
+        // in arena mode, the nodes of src belong to the slabs of dst by now
+        qtree_node *node = task.drop_head;
+        while (node != NULL)
+        {
+            qtree_node *next_node = node->less;
+            qtree_impl_filter_remove(dst, node->key);
+            if (visitor != NULL)
+            {
+                visitor(node, context);
+            }
+            qtree_impl_free_node(dst, node);
+            node = next_node;
+        }
+    }
+    else
+    {
+        rc = QTREE_ERR_UNSUPPORTED;
+    }
+
+    return rc;
+}
+
+
+/**
+ * Adds a node to the task's list of removed nodes, using the node's less
+ * field as the link to the next node
+ */
+static inline void qtree_impl_set_drop(qtree_set_task *task, qtree_node *node)
+{
+    node->less = task->drop_head;
+    if (task->drop_tail == NULL)
+    {
+        task->drop_tail = node;
+    }
+    task->drop_head = node;
+    ++(task->drop_count);
+}
+
+
+static inline void qtree_impl_set_drop_subtree(qtree_set_task *task, qtree_node *sub_root)
+{
+    qtree_node *node = sub_root;
+    while (node != NULL)
+    {
+        if (node->less != NULL)
+        {
+            node = node->less;
+        }
+        else
+        if (node->greater != NULL)
+        {
+            node = node->greater;
+        }
+        else
+        {
+            qtree_node *leaf = node;
+            node = leaf != sub_root ? leaf->parent : NULL;
+            if (node != NULL)
+            {
+                if (leaf == node->less)
+                {
+                    node->less = NULL;
                 }
                 else
                 {
-                    qtree_obj->root = sub_node->parent;
+                    node->greater = NULL;
                 }
-
-                rot_node->parent       = sub_node->parent;
-                sub_node->parent->less = rot_node;
             }
-            rot_node = rot_node->parent;
-            // end of L / RL rotations
+            qtree_impl_set_drop(task, leaf);
+        }
+    }
+}
+
+
+static inline void qtree_impl_set_merge_drops(qtree_set_task *task, qtree_set_task *sub_task)
+{
+    if (sub_task->drop_head != NULL)
+    {
+        sub_task->drop_tail->less = task->drop_head;
+        if (task->drop_tail == NULL)
+        {
+            task->drop_tail = sub_task->drop_tail;
+        }
+        task->drop_head = sub_task->drop_head;
+        task->drop_count += sub_task->drop_count;
+    }
+}
+
+
+static void qtree_impl_overlaps(
+    const qtree             *qtree_obj,
+    qtree_node              *node,
+    const void              *low,
+    const void              *high,
+    const qtree_visit_func  visitor,
+    void                    *context
+)
+{
+    while (node != NULL && qtree_obj->qtree_cmp(QTREE_MAX_END(qtree_obj, node), low) >= 0)
+    {
+        qtree_impl_overlaps(qtree_obj, node->less, low, high, visitor, context);
+        if (qtree_obj->qtree_cmp(node->key, high) > 0)
+        {
+            // All intervals of the greater subtree start after high
+            break;
         }
-        rot_node = rot_node->parent;
+        if (qtree_obj->qtree_cmp(qtree_obj->qtree_end(node->key, node->value), low) >= 0)
+        {
+            visitor(node, context);
+        }
+        node = node->greater;
     }
 }
 
 
 /**
- * Rebalances the tree after node insertion
+ * Deallocates all nodes of a subtree in ascending order of keys, calling the
+ * visitor, if any, for each node before it is deallocated
  *
- * WARNING! The order of statements, especially assignments, in this function
- *          is critical for the function's correct operation.
- *          DO NOT CHANGE THE ORDER OF ANY STATEMENTS.
+ * @return number of deallocated nodes
  */
-static inline void qtree_impl_rebalance_insert(
-    qtree      *qtree_obj,
-    qtree_node *sub_node,
-    qtree_node *rot_node
+static inline size_t qtree_impl_free_subtree(
+    qtree                   *qtree_obj,
+    qtree_node              *sub_root,
+    const qtree_visit_func  visitor,
+    void                    *context
 )
 {
-    // update balance and perform rotations
-    do
+    size_t count = 0;
+
+    qtree_node *stack[QTREE_MAX_HEIGHT];
+    size_t depth = 0;
+
+    qtree_node *node = sub_root;
+    while (node != NULL || depth > 0)
     {
-        if (rot_node->less == sub_node)
-        {
-            --(rot_node->balance);
-        }
-        else
+        while (node != NULL)
         {
-            ++(rot_node->balance);
+            stack[depth] = node;
+            ++depth;
+            node = node->less;
         }
+        --depth;
+        node = stack[depth];
 
-        if (rot_node->balance == 0)
+        qtree_node *greater_node = node->greater;
+        qtree_impl_filter_remove(qtree_obj, node->key);
+        if (visitor != NULL)
         {
-            break;
+            visitor(node, context);
         }
-        else
-        if (rot_node->balance == -2)
-        {
-            if (sub_node->balance == -1)
-            {
-                // rotate R
-                rot_node->balance = 0;
-                sub_node->balance = 0;
-
-                sub_node->parent = rot_node->parent;
-                if (rot_node->parent != NULL)
-                {
-                    if (rot_node->parent->less == rot_node)
-                    {
-                        rot_node->parent->less = sub_node;
-                    }
-                    else
-                    {
-                        rot_node->parent->greater = sub_node;
-                    }
-                }
-                else
-                {
-                    qtree_obj->root = sub_node;
-                }
-
-                rot_node->less = sub_node->greater;
-                if (sub_node->greater != NULL)
-                {
-                    sub_node->greater->parent = rot_node;
-                }
+        qtree_impl_free_node(qtree_obj, node);
+        ++count;
+        node = greater_node;
+    }
 
-                sub_node->greater = rot_node;
-                rot_node->parent = sub_node;
-            }
-            else
-            {
-                // rotate LR
-                if (sub_node->greater->balance == -1)
-                {
-                    sub_node->balance = 0;
-                    rot_node->balance = 1;
-                }
-                else
-                if (sub_node->greater->balance == 1)
-                {
-                    sub_node->balance = -1;
-                    rot_node->balance = 0;
-                }
-                else
-                {
-                    sub_node->balance = 0;
-                    rot_node->balance = 0;
-                }
-                sub_node->greater->balance = 0;
+    return count;
+}
 
-                sub_node->parent         = sub_node->greater;
-                sub_node->greater        = sub_node->greater->less;
-                sub_node->parent->less   = sub_node;
-                rot_node->less           = sub_node->parent->greater;
-                sub_node->parent->parent = rot_node->parent;
-                if (sub_node->greater != NULL)
-                {
-                    sub_node->greater->parent = sub_node;
-                }
-                if (rot_node->less != NULL)
-                {
-                    rot_node->less->parent = rot_node;
-                }
 
-                if (rot_node->parent != NULL)
-                {
-                    if (rot_node->parent->less == rot_node)
-                    {
-                        rot_node->parent->less = sub_node->parent;
-                    }
-                    else
-                    {
-                        rot_node->parent->greater = sub_node->parent;
-                    }
-                }
-                else
-                {
-                    qtree_obj->root = sub_node->parent;
-                }
+static inline void qtree_impl_visit_subtree(
+    qtree_node              *sub_root,
+    const qtree_visit_func  visitor,
+    void                    *context
+)
+{
+    qtree_node *stack[QTREE_MAX_HEIGHT];
+    size_t depth = 0;
 
-                rot_node->parent          = sub_node->parent;
-                sub_node->parent->greater = rot_node;
-            }
-            break;
-        }
-        else
-        if (rot_node->balance == 2)
+    qtree_node *node = sub_root;
+    while (node != NULL || depth > 0)
+    {
+        while (node != NULL)
         {
-            if (sub_node->balance == 1)
-            {
-                // rotate L
-                rot_node->balance = 0;
-                sub_node->balance = 0;
+            stack[depth] = node;
+            ++depth;
+            node = node->less;
+        }
+        --depth;
+        node = stack[depth];
+        visitor(node, context);
+        node = node->greater;
+    }
+}
 
-                sub_node->parent = rot_node->parent;
-                if (rot_node->parent != NULL)
-                {
-                    if (rot_node->parent->less == rot_node)
-                    {
-                        rot_node->parent->less = sub_node;
-                    }
-                    else
-                    {
-                        rot_node->parent->greater = sub_node;
-                    }
-                }
-                else
-                {
-                    qtree_obj->root = sub_node;
-                }
 
-                rot_node->greater = sub_node->less;
-                if (sub_node->less != NULL)
-                {
-                    sub_node->less->parent = rot_node;
-                }
+/**
+ * Visits the lead node, if any, followed by the subtree
+ *
+ * The subtree is divided into the less subtree, which is handed to another
+ * thread, and the root followed by the greater subtree, which becomes the
+ * lead node of the greater part, until each part has a single context.
+ */
+static void qtree_impl_visit_parallel(qtree_visit_task *task)
+{
+    qtree_node *sub_root = task->sub_root;
+    if (task->part_count > 1 && task->sub_height >= QTREE_PARALLEL_MIN_HEIGHT)
+    {
+        qtree_visit_task less_task    = *task;
+        qtree_visit_task greater_task = *task;
 
-                sub_node->less = rot_node;
-                rot_node->parent = sub_node;
-            }
-            else
-            {
-                // rotate RL
-                if (sub_node->less->balance == -1)
-                {
-                    sub_node->balance = 1;
-                    rot_node->balance = 0;
-                }
-                else
-                if (sub_node->less->balance == 1)
-                {
-                    sub_node->balance = 0;
-                    rot_node->balance = -1;
-                }
-                else
-                {
-                    sub_node->balance = 0;
-                    rot_node->balance = 0;
-                }
-                sub_node->less->balance = 0;
+        less_task.sub_root      = sub_root->less;
+        less_task.sub_height    = qtree_impl_less_height(sub_root, task->sub_height);
+        less_task.part_count    = task->part_count / 2;
+        greater_task.lead_node  = sub_root;
+        greater_task.sub_root   = sub_root->greater;
+        greater_task.sub_height = qtree_impl_greater_height(sub_root, task->sub_height);
+        greater_task.part_count = task->part_count - less_task.part_count;
+        // The greater part's contexts follow those that the less part actually uses
+        greater_task.contexts   = &(task->contexts[
+            qtree_impl_visit_part_count(less_task.sub_root, less_task.sub_height, less_task.part_count)
+        ]);
 
-                sub_node->parent          = sub_node->less;
-                sub_node->less            = sub_node->less->greater;
-                sub_node->parent->greater = sub_node;
-                rot_node->greater         = sub_node->parent->less;
-                sub_node->parent->parent  = rot_node->parent;
-                if (sub_node->less != NULL)
-                {
-                    sub_node->less->parent = sub_node;
-                }
-                if (rot_node->greater != NULL)
-                {
-                    rot_node->greater->parent = rot_node;
-                }
+        pthread_t less_thread;
+        const bool spawned = pthread_create(
+            &less_thread, NULL, qtree_impl_visit_thread, &less_task
+        ) == 0;
+        if (!spawned)
+        {
+            qtree_impl_visit_parallel(&less_task);
+        }
+        qtree_impl_visit_parallel(&greater_task);
+        if (spawned)
+        {
+            pthread_join(less_thread, NULL);
+        }
+    }
+    else
+    {
+        if (task->lead_node != NULL)
+        {
+            task->visitor(task->lead_node, task->contexts[0]);
+        }
+        qtree_impl_visit_subtree(sub_root, task->visitor, task->contexts[0]);
+    }
+}
 
-                if (rot_node->parent != NULL)
-                {
-                    if (rot_node->parent->less == rot_node)
-                    {
-                        rot_node->parent->less = sub_node->parent;
-                    }
-                    else
-                    {
-                        rot_node->parent->greater = sub_node->parent;
-                    }
-                }
-                else
-                {
-                    qtree_obj->root = sub_node->parent;
-                }
 
-                rot_node->parent       = sub_node->parent;
-                sub_node->parent->less = rot_node;
-            }
-            break;
-        }
+static void *qtree_impl_visit_thread(void *task)
+{
+    qtree_impl_visit_parallel(task);
+    return NULL;
+}
 
-        sub_node = rot_node;
-        rot_node = rot_node->parent;
+
+/**
+ * Determines the number of partitions that qtree_impl_visit_parallel() divides
+ * a subtree into, which takes O(part_count)
+ */
+static size_t qtree_impl_visit_part_count(
+    const qtree_node    *sub_root,
+    const int           sub_height,
+    const size_t        part_count
+)
+{
+    size_t count = 1;
+    if (part_count > 1 && sub_height >= QTREE_PARALLEL_MIN_HEIGHT)
+    {
+        const size_t less_part_count = part_count / 2;
+        count = qtree_impl_visit_part_count(
+            sub_root->less, qtree_impl_less_height(sub_root, sub_height), less_part_count
+        ) + qtree_impl_visit_part_count(
+            sub_root->greater, qtree_impl_greater_height(sub_root, sub_height), part_count - less_part_count
+        );
     }
-    while (rot_node != NULL);
+    return count;
 }
 
 
-static inline qtree_rc qtree_impl_insert_node(qtree *qtree_obj, qtree_node *ins_node)
+static inline qtree_node *qtree_impl_alloc_node(qtree *qtree_obj)
 {
-    qtree_rc rc = QTREE_PASS;
-
-    if (qtree_obj->root == NULL)
+    qtree_node *node = NULL;
+    if ((qtree_obj->options & QTREE_OPT_ARENA) == 0)
+    {
+        node = malloc(qtree_obj->node_size);
+    }
+    else
+    if (qtree_obj->free_list != NULL)
     {
-        qtree_obj->root   = ins_node;
-        ins_node->less    = NULL;
-        ins_node->greater = NULL;
-        ins_node->parent  = NULL;
-        ins_node->balance = 0;
-        ++(qtree_obj->size);
+        node = qtree_obj->free_list;
+        qtree_obj->free_list = node->less;
     }
     else
     {
-        qtree_node *parent_node = qtree_obj->root;
-        while (true)
+        if (qtree_obj->slab_avail == 0)
         {
-            const int cmp_rc = qtree_obj->qtree_cmp(ins_node->key, parent_node->key);
-            if (cmp_rc < 0)
-            {
-                if (parent_node->less == NULL)
-                {
-                    parent_node->less = ins_node;
-                    ins_node->parent  = parent_node;
-                    ins_node->less    = NULL;
-                    ins_node->greater = NULL;
-                    ins_node->balance = 0;
-                    ++(qtree_obj->size);
-                    qtree_impl_rebalance_insert(qtree_obj, ins_node, parent_node);
-                    break;
-                }
-                else
-                {
-                    parent_node = parent_node->less;
-                }
-            }
-            else
-            if (cmp_rc > 0)
+            // each slab doubles the capacity of its predecessor up to the limit
+            size_t capacity = QTREE_SLAB_MIN_NODES;
+            if (qtree_obj->slab_list != NULL)
             {
-                if (parent_node->greater == NULL)
-                {
-                    parent_node->greater = ins_node;
-                    ins_node->parent     = parent_node;
-                    ins_node->less       = NULL;
-                    ins_node->greater    = NULL;
-                    ins_node->balance    = 0;
-                    ++(qtree_obj->size);
-                    qtree_impl_rebalance_insert(qtree_obj, ins_node, parent_node);
-                    break;
-                }
-                else
+                capacity = qtree_obj->slab_list->capacity * 2;
+                if (capacity > QTREE_SLAB_MAX_NODES)
                 {
-                    parent_node = parent_node->greater;
+                    capacity = QTREE_SLAB_MAX_NODES;
                 }
             }
-            else
+            qtree_slab *slab = malloc(sizeof (qtree_slab) + capacity * qtree_obj->node_size);
+            if (slab != NULL)
             {
-                rc = QTREE_ERR_EXISTS;
-                break;
+                slab->next            = qtree_obj->slab_list;
+                slab->capacity        = capacity;
+                qtree_obj->slab_list  = slab;
+                qtree_obj->slab_avail = capacity;
             }
         }
+        if (qtree_obj->slab_avail > 0)
+        {
+            qtree_slab *slab = qtree_obj->slab_list;
+            node = qtree_impl_slab_node(qtree_obj, slab, slab->capacity - qtree_obj->slab_avail);
+            --(qtree_obj->slab_avail);
+        }
     }
 
-    return rc;
+    return node;
 }
 
 
-static inline void qtree_impl_remove_node(qtree *qtree_obj, qtree_node *crt)
+static inline qtree_node *qtree_impl_slab_node(const qtree *qtree_obj, qtree_slab *slab, const size_t idx)
 {
-    qtree_impl_unlink_node(qtree_obj, crt);
-    free(crt);
+    return (qtree_node *) ((char *) slab->nodes + idx * qtree_obj->node_size);
+}
+
+
+static inline void qtree_impl_free_node(qtree *qtree_obj, qtree_node *node)
+{
+    if ((qtree_obj->options & QTREE_OPT_ARENA) == 0)
+    {
+        free(node);
+    }
+    else
+    {
+        node->less           = qtree_obj->free_list;
+        qtree_obj->free_list = node;
+    }
 }
 
 
-static inline void qtree_impl_unlink_node(qtree *qtree_obj, qtree_node *rm_node)
-{
-    --(qtree_obj->size);
+static inline void qtree_impl_unlink_node(qtree *qtree_obj, qtree_node *rm_node)
+{
+    QTREE_STORE_FIELD(qtree_obj, qtree_obj->size, qtree_obj->size - 1);
+    qtree_impl_filter_remove(qtree_obj, rm_node->key);
+
+    // The least node has no less child, so its successor is found in O(1), and vice versa
+    if (qtree_obj->min_node == rm_node)
+    {
+        qtree_obj->min_node = qtree_impl_successor(rm_node);
+    }
+    if (qtree_obj->max_node == rm_node)
+    {
+        qtree_obj->max_node = qtree_impl_predecessor(rm_node);
+    }
+
+    if ((qtree_obj->options & QTREE_OPT_THREADED) != 0)
+    {
+        const size_t links_offset = qtree_obj->links_offset;
+        const qtree_links *rm_links = &QTREE_LINKS(links_offset, rm_node);
+        if (rm_links->prev != NULL)
+        {
+            QTREE_LINKS(links_offset, rm_links->prev).next = rm_links->next;
+        }
+        if (rm_links->next != NULL)
+        {
+            QTREE_LINKS(links_offset, rm_links->next).prev = rm_links->prev;
+        }
+    }
 
     if (rm_node->less == NULL && rm_node->greater == NULL)
     {
@@ -837,7 +4251,7 @@ static inline void qtree_impl_unlink_node(qtree *qtree_obj, qtree_node *rm_node)
         if (qtree_obj->root == rm_node)
         {
             // root node leaf
-            qtree_obj->root = NULL;
+            QTREE_STORE_LINK(qtree_obj, qtree_obj->root, NULL);
         }
         else
         {
@@ -851,7 +4265,7 @@ static inline void qtree_impl_unlink_node(qtree *qtree_obj, qtree_node *rm_node)
 
                 // save direction
                 dir = QTREE_DIR_LESS;
-                rot_node->less = NULL;
+                QTREE_STORE_LINK(qtree_obj, rot_node->less, NULL);
             }
             else
             {
@@ -860,9 +4274,10 @@ static inline void qtree_impl_unlink_node(qtree *qtree_obj, qtree_node *rm_node)
 
                 // save direction
                 dir = QTREE_DIR_GREATER;
-                rot_node->greater = NULL;
+                QTREE_STORE_LINK(qtree_obj, rot_node->greater, NULL);
             }
             qtree_impl_rebalance_remove(qtree_obj, dir, rot_node);
+            qtree_impl_update_path(qtree_obj, rot_node);
         }
     }
     else
@@ -900,20 +4315,20 @@ static inline void qtree_impl_unlink_node(qtree *qtree_obj, qtree_node *rm_node)
             if (rep_node->less != NULL)
             {
                 // replace node by its left child
-                rot_node->less         = rep_node->less;
+                QTREE_STORE_LINK(qtree_obj, rot_node->less, rep_node->less);
                 rep_node->less->parent = rot_node;
             }
             else
             if (rep_node->greater != NULL)
             {
                 // replace node by its right child
-                rot_node->less            = rep_node->greater;
+                QTREE_STORE_LINK(qtree_obj, rot_node->less, rep_node->greater);
                 rep_node->greater->parent = rot_node;
             }
             else
             {
                 // non-root leaf node
-                rot_node->less = NULL;
+                QTREE_STORE_LINK(qtree_obj, rot_node->less, NULL);
             }
         }
         else
@@ -927,52 +4342,56 @@ static inline void qtree_impl_unlink_node(qtree *qtree_obj, qtree_node *rm_node)
             if (rep_node->less != NULL)
             {
                 // replace node by its left child
-                rot_node->greater      = rep_node->less;
+                QTREE_STORE_LINK(qtree_obj, rot_node->greater, rep_node->less);
                 rep_node->less->parent = rot_node;
             }
             else
             if (rep_node->greater != NULL)
             {
                 // replace node by its right child
-                rot_node->greater         = rep_node->greater;
+                QTREE_STORE_LINK(qtree_obj, rot_node->greater, rep_node->greater);
                 rep_node->greater->parent = rot_node;
             }
             else
             {
                 // non-root leaf node
-                rot_node->greater = NULL;
+                QTREE_STORE_LINK(qtree_obj, rot_node->greater, NULL);
             }
         }
 
+        // The replacement node takes over the links of the removed node before it
+        // is linked into the removed node's position, so that concurrent readers
+        // never reach the replacement node through its new position with its old links
+        rep_node->parent  = rm_node->parent;
+        QTREE_STORE_LINK(qtree_obj, rep_node->less, rm_node->less);
+        QTREE_STORE_LINK(qtree_obj, rep_node->greater, rm_node->greater);
+        rep_node->balance = rm_node->balance;
+        if (rm_node->less != NULL)
+        {
+            rm_node->less->parent = rep_node;
+        }
+        if (rm_node->greater != NULL)
+        {
+            rm_node->greater->parent = rep_node;
+        }
+
         // replace node contents
         if (rm_node->parent == NULL)
         {
             // Node to be removed is the root node
-            qtree_obj->root = rep_node;
+            QTREE_STORE_LINK(qtree_obj, qtree_obj->root, rep_node);
         }
         else
         {
             if (rm_node->parent->less == rm_node)
             {
-                rm_node->parent->less = rep_node;
+                QTREE_STORE_LINK(qtree_obj, rm_node->parent->less, rep_node);
             }
             else
             {
-                rm_node->parent->greater = rep_node;
+                QTREE_STORE_LINK(qtree_obj, rm_node->parent->greater, rep_node);
             }
         }
-        if (rm_node->less != NULL)
-        {
-            rm_node->less->parent = rep_node;
-        }
-        if (rm_node->greater != NULL)
-        {
-            rm_node->greater->parent = rep_node;
-        }
-        rep_node->parent  = rm_node->parent;
-        rep_node->less    = rm_node->less;
-        rep_node->greater = rm_node->greater;
-        rep_node->balance = rm_node->balance;
 
         if (rot_node == rm_node)
         {
@@ -980,16 +4399,75 @@ static inline void qtree_impl_unlink_node(qtree *qtree_obj, qtree_node *rm_node)
         }
 
         qtree_impl_rebalance_remove(qtree_obj, dir, rot_node);
+        qtree_impl_update_path(qtree_obj, rot_node);
+    }
+}
+
+
+static inline uint64_t qtree_impl_prefix(const qtree *qtree_obj, const void *key)
+{
+    return qtree_obj->qtree_prefix != NULL ? qtree_obj->qtree_prefix(key) : 0;
+}
+
+
+static inline void qtree_impl_store_prefix(const qtree *qtree_obj, qtree_node *node, const uint64_t prefix)
+{
+    if (qtree_obj->qtree_prefix != NULL)
+    {
+        QTREE_PREFIX(qtree_obj, node) = prefix;
+    }
+}
+
+
+/**
+ * Compares a key to the key of a node, calling the comparator only if the prefixes are equal
+ *
+ * use_prefix must be set if the tree has a prefix function. The descents of
+ * searches and insertions are specialized by calling them with a constant
+ * use_prefix, so that the prefix function is checked once per descent instead
+ * of once per comparison.
+ */
+static inline int qtree_impl_cmp(
+    const qtree         *qtree_obj,
+    const void          *key,
+    const uint64_t      key_prefix,
+    const qtree_node    *node,
+    const bool          use_prefix
+)
+{
+    int cmp_rc = 0;
+    if (use_prefix && key_prefix != QTREE_PREFIX(qtree_obj, node))
+    {
+        cmp_rc = key_prefix < QTREE_PREFIX(qtree_obj, node) ? -1 : 1;
+    }
+    else
+    {
+        cmp_rc = qtree_obj->qtree_cmp(key, node->key);
     }
+    return cmp_rc;
 }
 
 
 static inline qtree_node *qtree_impl_find_node(const qtree *qtree_obj, const void *key)
 {
+    qtree_node *node = NULL;
+    if (qtree_impl_filter_contains(qtree_obj, key))
+    {
+        node = qtree_obj->qtree_prefix != NULL ?
+            qtree_impl_search_node(qtree_obj, key, true) :
+            qtree_impl_search_node(qtree_obj, key, false);
+    }
+    return node;
+}
+
+
+static inline qtree_node *qtree_impl_search_node(const qtree *qtree_obj, const void *key, const bool use_prefix)
+{
+    const uint64_t key_prefix = use_prefix ? qtree_obj->qtree_prefix(key) : 0;
     qtree_node *node = qtree_obj->root;
     while (node != NULL)
     {
-        int cmp_rc = qtree_obj->qtree_cmp(key, node->key);
+        int cmp_rc = qtree_impl_cmp(qtree_obj, key, key_prefix, node, use_prefix);
         if (cmp_rc < 0)
         {
             node = node->less;
@@ -1009,64 +4487,426 @@ static inline qtree_node *qtree_impl_find_node(const qtree *qtree_obj, const voi
 }
 
 
-static inline void qtree_impl_init(qtree *qtree_obj, const qtree_cmp_func cmp_func_ptr)
+/**
+ * Finds the nearest node in the specified direction from the key
+ *
+ * @return for QTREE_DIR_GREATER, the node with the least key greater than the
+ *         specified key, for QTREE_DIR_LESS, the node with the greatest key less
+ *         than the specified key, or if inclusive is set, the node with an equal
+ *         key if there is such a node
+ */
+static inline qtree_node *qtree_impl_find_bound(
+    const qtree     *qtree_obj,
+    const void      *key,
+    const qtree_dir dir,
+    const bool      inclusive
+)
 {
-    qtree_obj->root      = NULL;
-    qtree_obj->size      = 0;
-    qtree_obj->qtree_cmp = cmp_func_ptr;
+    return qtree_obj->qtree_prefix != NULL ?
+        qtree_impl_search_bound(qtree_obj, key, dir, inclusive, true) :
+        qtree_impl_search_bound(qtree_obj, key, dir, inclusive, false);
 }
 
 
-static inline void qtree_impl_iterator_init(const qtree *qtree_obj, qtree_it *iter)
+static inline qtree_node *qtree_impl_search_bound(
+    const qtree     *qtree_obj,
+    const void      *key,
+    const qtree_dir dir,
+    const bool      inclusive,
+    const bool      use_prefix
+)
 {
-    if (qtree_obj->root != NULL)
+    qtree_node *result = NULL;
+
+    const uint64_t key_prefix = use_prefix ? qtree_obj->qtree_prefix(key) : 0;
+    qtree_node *node = qtree_obj->root;
+    while (node != NULL)
+    {
+        const int cmp_rc = qtree_impl_cmp(qtree_obj, key, key_prefix, node, use_prefix);
+        if (cmp_rc == 0 && inclusive)
+        {
+            result = node;
+            break;
+        }
+        else
+        if (dir == QTREE_DIR_GREATER)
+        {
+            if (cmp_rc < 0)
+            {
+                result = node;
+                node   = node->less;
+            }
+            else
+            {
+                node = node->greater;
+            }
+        }
+        else
+        {
+            if (cmp_rc > 0)
+            {
+                result = node;
+                node   = node->greater;
+            }
+            else
+            {
+                node = node->less;
+            }
+        }
+    }
+
+    return result;
+}
+
+
+static inline qtree_node *qtree_impl_successor(qtree_node *node)
+{
+    if (node->greater != NULL)
     {
-        iter->next = qtree_obj->root;
-        while (iter->next->less != NULL)
+        node = node->greater;
+        while (node->less != NULL)
         {
-            iter->next = iter->next->less;
+            node = node->less;
         }
     }
     else
     {
-        iter->next = NULL;
+        do
+        {
+            if (node->parent != NULL)
+            {
+                if (node->parent->less == node)
+                {
+                    node = node->parent;
+                    break;
+                }
+            }
+            node = node->parent;
+        }
+        while (node != NULL);
     }
+
+    return node;
 }
 
 
-static inline void qtree_impl_clear(qtree *qtree_obj)
+static inline qtree_node *qtree_impl_predecessor(qtree_node *node)
 {
-    if (qtree_obj != NULL)
+    if (node->less != NULL)
     {
-        qtree_node *node = qtree_obj->root;
+        node = node->less;
+        while (node->greater != NULL)
+        {
+            node = node->greater;
+        }
+    }
+    else
+    {
+        do
+        {
+            if (node->parent != NULL)
+            {
+                if (node->parent->greater == node)
+                {
+                    node = node->parent;
+                    break;
+                }
+            }
+            node = node->parent;
+        }
+        while (node != NULL);
+    }
 
-        while (node != NULL)
+    return node;
+}
+
+
+/**
+ * Selects the block of the filter that the key maps to
+ *
+ * The hash is mixed, so that the counters within the block are selected by bits
+ * that are independent of the block index even if the hash function is weak.
+ */
+static inline uint8_t *qtree_impl_filter_block(const qtree_filter *filter, const void *key, uint64_t *hash)
+{
+    uint64_t mix = filter->qtree_hash(key);
+    mix ^= mix >> 33;
+    mix *= 0xFF51AFD7ED558CCDULL;
+    mix ^= mix >> 33;
+    mix *= 0xC4CEB9FE1A85EC53ULL;
+    mix ^= mix >> 33;
+    *hash = mix;
+    return &(filter->counters[((size_t) (mix >> 24) & filter->block_mask) * QTREE_FILTER_BLOCK_SIZE]);
+}
+
+
+static inline void qtree_impl_filter_add(const qtree *qtree_obj, const void *key)
+{
+    if (qtree_obj->filter != NULL && !qtree_obj->filter->stale)
+    {
+        uint64_t hash = 0;
+        uint8_t *block = qtree_impl_filter_block(qtree_obj->filter, key, &hash);
+        for (int shift = 0; shift < 24; shift += 6)
+        {
+            uint8_t *counter = &(block[(hash >> shift) % QTREE_FILTER_BLOCK_SIZE]);
+            if (*counter != QTREE_FILTER_COUNTER_MAX)
+            {
+                ++(*counter);
+            }
+        }
+    }
+}
+
+
+static inline void qtree_impl_filter_remove(const qtree *qtree_obj, const void *key)
+{
+    if (qtree_obj->filter != NULL && !qtree_obj->filter->stale)
+    {
+        uint64_t hash = 0;
+        uint8_t *block = qtree_impl_filter_block(qtree_obj->filter, key, &hash);
+        for (int shift = 0; shift < 24; shift += 6)
+        {
+            uint8_t *counter = &(block[(hash >> shift) % QTREE_FILTER_BLOCK_SIZE]);
+            if (*counter != QTREE_FILTER_COUNTER_MAX && *counter != 0)
+            {
+                --(*counter);
+            }
+        }
+    }
+}
+
+
+/**
+ * @return false if the key is definitely not present, true if it may be present
+ */
+static inline bool qtree_impl_filter_contains(const qtree *qtree_obj, const void *key)
+{
+    bool present = true;
+    if (qtree_obj->filter != NULL && !qtree_obj->filter->stale)
+    {
+        uint64_t hash = 0;
+        const uint8_t *block = qtree_impl_filter_block(qtree_obj->filter, key, &hash);
+        for (int shift = 0; shift < 24 && present; shift += 6)
+        {
+            present = block[(hash >> shift) % QTREE_FILTER_BLOCK_SIZE] != 0;
+        }
+    }
+    return present;
+}
+
+
+static inline void qtree_impl_filter_add_subtree(const qtree *qtree_obj, const qtree_node *sub_root)
+{
+    if (qtree_obj->filter != NULL && !qtree_obj->filter->stale && sub_root != NULL)
+    {
+        const qtree_node *stack[QTREE_MAX_HEIGHT];
+        size_t depth = 0;
+        stack[depth] = sub_root;
+        ++depth;
+        while (depth > 0)
         {
+            --depth;
+            const qtree_node *node = stack[depth];
+            qtree_impl_filter_add(qtree_obj, node->key);
             if (node->less != NULL)
             {
-                node = node->less;
+                stack[depth] = node->less;
+                ++depth;
             }
-            else
             if (node->greater != NULL)
             {
-                node = node->greater;
+                stack[depth] = node->greater;
+                ++depth;
             }
-            else
+        }
+    }
+}
+
+
+static inline void qtree_impl_filter_reset(const qtree *qtree_obj)
+{
+    if (qtree_obj != NULL && qtree_obj->filter != NULL)
+    {
+        const size_t counters_size = (qtree_obj->filter->block_mask + 1) * QTREE_FILTER_BLOCK_SIZE;
+        for (size_t idx = 0; idx < counters_size; ++idx)
+        {
+            qtree_obj->filter->counters[idx] = 0;
+        }
+        qtree_obj->filter->stale = false;
+    }
+}
+
+
+/**
+ * Marks the filter as stale after entries were moved in or out in bulk
+ */
+static inline void qtree_impl_filter_invalidate(const qtree *qtree_obj)
+{
+    if (qtree_obj->filter != NULL)
+    {
+        qtree_obj->filter->stale = true;
+    }
+}
+
+
+/**
+ * Initializes an empty tree with the comparator, callbacks and options of another tree
+ */
+static inline void qtree_impl_init_like(qtree *qtree_obj, const qtree *model_obj)
+{
+    *qtree_obj = *model_obj;
+    qtree_obj->root       = NULL;
+    qtree_obj->min_node   = NULL;
+    qtree_obj->max_node   = NULL;
+    qtree_obj->size       = 0;
+    qtree_obj->slab_list  = NULL;
+    qtree_obj->free_list  = NULL;
+    qtree_obj->slab_avail = 0;
+    qtree_obj->filter     = NULL;
+}
+
+
+/**
+ * Releases the filter and the arena slabs of an empty tree that is about to be
+ * reinitialized
+ */
+static inline void qtree_impl_release_empty(qtree *qtree_obj)
+{
+    qtree_impl_clear(qtree_obj);
+    free(qtree_obj->filter);
+    qtree_obj->filter = NULL;
+}
+
+
+static inline void qtree_impl_init(
+    qtree                   *qtree_obj,
+    const qtree_cmp_func    cmp_func_ptr,
+    const unsigned int      options
+)
+{
+    qtree_obj->root         = NULL;
+    qtree_obj->min_node     = NULL;
+    qtree_obj->max_node     = NULL;
+    qtree_obj->size         = 0;
+    qtree_obj->qtree_cmp    = cmp_func_ptr;
+    qtree_obj->qtree_prefix = NULL;
+    qtree_obj->qtree_end    = NULL;
+    qtree_obj->aggr_map     = NULL;
+    qtree_obj->aggr_combine = NULL;
+    qtree_obj->aggr_identity.u64 = 0;
+    qtree_obj->options      = options;
+    qtree_obj->slab_list    = NULL;
+    qtree_obj->free_list    = NULL;
+    qtree_obj->slab_avail   = 0;
+    qtree_obj->filter       = NULL;
+    qtree_impl_init_layout(qtree_obj);
+}
+
+
+/**
+ * Determines the offsets of the fields that follow each node for the options
+ * and the prefix function of the tree
+ *
+ * A tree without options and prefix function has nodes of sizeof (qtree_node).
+ * The prefix is placed first, because it is read by every comparison of a search.
+ * All fields are 8 bytes or multiples thereof, so each field is aligned.
+ */
+static inline void qtree_impl_init_layout(qtree *qtree_obj)
+{
+    size_t node_size = sizeof (qtree_node);
+    qtree_obj->prefix_offset = 0;
+    qtree_obj->count_offset  = 0;
+    qtree_obj->end_offset    = 0;
+    qtree_obj->aggr_offset   = 0;
+    qtree_obj->links_offset  = 0;
+    if (qtree_obj->qtree_prefix != NULL)
+    {
+        qtree_obj->prefix_offset = node_size;
+        node_size += sizeof (uint64_t);
+    }
+    if ((qtree_obj->options & QTREE_OPT_ORDER_STATS) != 0)
+    {
+        qtree_obj->count_offset = node_size;
+        node_size += sizeof (size_t);
+    }
+    if ((qtree_obj->options & QTREE_OPT_INTERVAL) != 0)
+    {
+        qtree_obj->end_offset = node_size;
+        node_size += sizeof (const void *);
+    }
+    if ((qtree_obj->options & QTREE_OPT_AGGREGATE) != 0)
+    {
+        qtree_obj->aggr_offset = node_size;
+        node_size += sizeof (qtree_aggr);
+    }
+    if ((qtree_obj->options & QTREE_OPT_THREADED) != 0)
+    {
+        qtree_obj->links_offset = node_size;
+        node_size += sizeof (qtree_links);
+    }
+    qtree_obj->node_size = node_size;
+}
+
+
+static inline void qtree_impl_iterator_init(const qtree *qtree_obj, qtree_it *iter)
+{
+    iter->next         = qtree_obj->min_node;
+    iter->end          = NULL;
+    iter->current      = NULL;
+    iter->links_offset = qtree_obj->links_offset;
+}
+
+
+static inline void qtree_impl_clear(qtree *qtree_obj)
+{
+    if (qtree_obj != NULL)
+    {
+        if ((qtree_obj->options & QTREE_OPT_ARENA) != 0)
+        {
+            // all nodes are released together with their slabs
+            qtree_slab *slab = qtree_obj->slab_list;
+            while (slab != NULL)
             {
-                qtree_node *leaf = node;
-                node = node->parent;
-                if (node != NULL)
+                qtree_slab *next_slab = slab->next;
+                free(slab);
+                slab = next_slab;
+            }
+            qtree_obj->slab_list  = NULL;
+            qtree_obj->free_list  = NULL;
+            qtree_obj->slab_avail = 0;
+        }
+        else
+        {
+            qtree_node *node = qtree_obj->root;
+
+            while (node != NULL)
+            {
+                if (node->less != NULL)
                 {
-                    if (leaf == node->less)
-                    {
-                        node->less = NULL;
-                    }
-                    else
+                    node = node->less;
+                }
+                else
+                if (node->greater != NULL)
+                {
+                    node = node->greater;
+                }
+                else
+                {
+                    qtree_node *leaf = node;
+                    node = node->parent;
+                    if (node != NULL)
                     {
-                        node->greater = NULL;
+                        if (leaf == node->less)
+                        {
+                            node->less = NULL;
+                        }
+                        else
+                        {
+                            node->greater = NULL;
+                        }
                     }
+                    free(leaf);
                 }
-                free(leaf);
             }
         }
     }
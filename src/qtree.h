@@ -5,28 +5,82 @@
 #include <sys/types.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 typedef enum
 {
-    QTREE_PASS       = 0,
-    QTREE_ERR_NOMEM  = 1,
-    QTREE_ERR_EXISTS = 2
+    QTREE_PASS            = 0,
+    QTREE_ERR_NOMEM       = 1,
+    QTREE_ERR_EXISTS      = 2,
+    QTREE_ERR_UNSUPPORTED = 3
 }
 qtree_rc;
 
+typedef enum
+{
+    QTREE_OPT_NONE        = 0,
+    QTREE_OPT_ARENA       = 1,
+    QTREE_OPT_ORDER_STATS = 2,
+    QTREE_OPT_THREADED    = 4,
+    QTREE_OPT_INTERVAL    = 8,
+    QTREE_OPT_AGGREGATE   = 16,
+    QTREE_OPT_CONCURRENT  = 32
+}
+qtree_opt;
+
 typedef int (*qtree_cmp_func)(const void *val_alpha, const void *val_bravo);
+typedef uint64_t (*qtree_prefix_func)(const void *key);
+typedef const void *(*qtree_end_func)(const void *key, const void *value);
+typedef uint64_t (*qtree_hash_func)(const void *key);
 
 typedef struct qtree_s      qtree;
 typedef struct qtree_node_s qtree_node;
 typedef struct qtree_it_s   qtree_it;
+typedef struct qtree_slab_s qtree_slab;
+typedef struct qtree_filter_s qtree_filter;
+typedef union qtree_aggr_u  qtree_aggr;
+
+// Aggregate of the entries of a subtree, of a type chosen by the user
+union qtree_aggr_u
+{
+    uint64_t    u64;
+    int64_t     i64;
+    double      dbl;
+    const void  *ptr;
+};
+
+typedef void (*qtree_visit_func)(qtree_node *node, void *context);
+typedef void (*qtree_reduce_func)(void *context, void *part_context);
+typedef qtree_aggr (*qtree_aggr_map_func)(const void *key, const void *value);
+typedef qtree_aggr (*qtree_aggr_combine_func)(qtree_aggr less_aggr, qtree_aggr greater_aggr);
 
 struct qtree_s
 {
-    qtree_node      *root;
-    size_t          size;
-    qtree_cmp_func  qtree_cmp;
+    qtree_node              *root;
+    qtree_node              *min_node;
+    qtree_node              *max_node;
+    size_t                  size;
+    qtree_cmp_func          qtree_cmp;
+    qtree_prefix_func       qtree_prefix;
+    qtree_end_func          qtree_end;
+    qtree_aggr_map_func     aggr_map;
+    qtree_aggr_combine_func aggr_combine;
+    qtree_aggr              aggr_identity;
+    unsigned int            options;
+    size_t                  node_size;
+    size_t                  prefix_offset;
+    size_t                  count_offset;
+    size_t                  end_offset;
+    size_t                  aggr_offset;
+    size_t                  links_offset;
+    qtree_slab              *slab_list;
+    qtree_node              *free_list;
+    size_t                  slab_avail;
+    qtree_filter            *filter;
 };
 
+// The options and the prefix function of a tree append fields to each node,
+// which are only accessed at the offsets stored in the tree, see qtree_node_size()
 struct qtree_node_s
 {
     const void  *key;
@@ -40,26 +94,156 @@ struct qtree_node_s
 struct qtree_it_s
 {
     qtree_node  *next;
+    qtree_node  *end;
+    qtree_node  *current;
+    size_t      links_offset;
 };
 
 void        qtree_dealloc(qtree *qtree_obj);
 void        qtree_clear(qtree *qtree_obj);
 qtree       *qtree_alloc(qtree_cmp_func cmp_func_ptr);
+qtree       *qtree_alloc_opt(qtree_cmp_func cmp_func_ptr, unsigned int options);
 void        qtree_init(qtree *qtree_obj, qtree_cmp_func cmp_func_ptr);
+void        qtree_init_opt(qtree *qtree_obj, qtree_cmp_func cmp_func_ptr, unsigned int options);
+void        qtree_init_arena(qtree *qtree_obj, qtree_cmp_func cmp_func_ptr);
+void        qtree_init_interval(
+    qtree           *qtree_obj,
+    qtree_cmp_func  cmp_func_ptr,
+    qtree_end_func  end_func_ptr,
+    unsigned int    options
+);
+void        qtree_init_aggregate(
+    qtree                   *qtree_obj,
+    qtree_cmp_func          cmp_func_ptr,
+    qtree_aggr_map_func     map_func_ptr,
+    qtree_aggr_combine_func combine_func_ptr,
+    qtree_aggr              identity,
+    unsigned int            options
+);
+qtree_rc    qtree_set_prefix_func(qtree *qtree_obj, qtree_prefix_func prefix_func_ptr);
+uint64_t    qtree_string_prefix(const void *key);
+qtree_rc    qtree_set_filter(qtree *qtree_obj, qtree_hash_func hash_func_ptr, size_t capacity);
+void        qtree_rebuild_filter(qtree *qtree_obj);
 qtree_rc    qtree_insert(
     qtree       *qtree_obj,
     const void  *key,
     const void  *value
 );
 qtree_rc    qtree_insert_node(qtree *qtree_obj, qtree_node *node);
+size_t      qtree_node_size(const qtree *qtree_obj);
+qtree_rc    qtree_insert_hint(
+    qtree       *qtree_obj,
+    qtree_node  **hint,
+    const void  *key,
+    const void  *value
+);
+qtree_rc    qtree_build_sorted(
+    qtree       *qtree_obj,
+    const void  *keys[],
+    const void  *values[],
+    size_t      count
+);
+qtree_rc    qtree_insert_sorted(
+    qtree       *qtree_obj,
+    const void  *keys[],
+    const void  *values[],
+    size_t      count
+);
 void        qtree_remove(qtree *qtree_obj, const void *key);
 void        qtree_remove_node(qtree *qtree_obj, qtree_node *node);
 void        qtree_unlink_node(qtree *qtree_obj, qtree_node *node);
+size_t      qtree_remove_range(
+    qtree               *qtree_obj,
+    const void          *low,
+    const void          *high,
+    qtree_visit_func    visitor,
+    void                *context
+);
 void        *qtree_get(const qtree *qtree_obj, const void *key);
 qtree_node  *qtree_get_node(const qtree *qtree_obj, const void *key);
+void        qtree_get_batch(
+    const qtree *qtree_obj,
+    const void  *keys[],
+    void        *values_out[],
+    size_t      count
+);
 qtree_it    *qtree_iterator(const qtree *qtree_obj);
 void        qtree_iterator_init(const qtree *qtree_obj, qtree_it *iter);
 qtree_node  *qtree_next(qtree_it *iter);
+qtree_node  *qtree_prev(qtree_it *iter);
+void        qtree_iterator_remove(qtree *qtree_obj, qtree_it *iter);
+void        qtree_iterator_init_reverse(const qtree *qtree_obj, qtree_it *iter);
+void        qtree_iterator_seek(const qtree *qtree_obj, qtree_it *iter, const void *key);
+void        qtree_iterator_seek_reverse(const qtree *qtree_obj, qtree_it *iter, const void *key);
+void        qtree_range_iterator_init(
+    const qtree *qtree_obj,
+    qtree_it    *iter,
+    const void  *start_key,
+    const void  *end_key
+);
+void        qtree_range_iterator_init_reverse(
+    const qtree *qtree_obj,
+    qtree_it    *iter,
+    const void  *start_key,
+    const void  *end_key
+);
+qtree_node  *qtree_lower_bound(const qtree *qtree_obj, const void *key);
+qtree_node  *qtree_upper_bound(const qtree *qtree_obj, const void *key);
+qtree_node  *qtree_peek_min(const qtree *qtree_obj);
+qtree_node  *qtree_peek_max(const qtree *qtree_obj);
+bool        qtree_pop_min(qtree *qtree_obj, const void **key, const void **value);
+bool        qtree_pop_max(qtree *qtree_obj, const void **key, const void **value);
+size_t      qtree_pop_until(
+    qtree               *qtree_obj,
+    const void          *key,
+    qtree_visit_func    visitor,
+    void                *context
+);
+qtree_node  *qtree_floor(const qtree *qtree_obj, const void *key);
+qtree_node  *qtree_ceiling(const qtree *qtree_obj, const void *key);
+qtree_node  *qtree_select(const qtree *qtree_obj, size_t index);
+size_t      qtree_rank(const qtree *qtree_obj, const void *key);
+size_t      qtree_count_range(const qtree *qtree_obj, const void *start_key, const void *end_key);
+qtree_rc    qtree_union(qtree *dst, qtree *src, qtree_visit_func visitor, void *context);
+void        qtree_intersection(qtree *dst, const qtree *src);
+void        qtree_difference(qtree *dst, const qtree *src);
+qtree_rc    qtree_union_parallel(
+    qtree               *dst,
+    qtree               *src,
+    size_t              thread_count,
+    qtree_visit_func    visitor,
+    void                *context
+);
+void        qtree_intersection_parallel(qtree *dst, const qtree *src, size_t thread_count);
+void        qtree_difference_parallel(qtree *dst, const qtree *src, size_t thread_count);
+qtree_aggr  qtree_aggregate_range(const qtree *qtree_obj, const void *low, const void *high);
+void        qtree_refresh_node(const qtree *qtree_obj, qtree_node *node);
+void        qtree_interval_overlaps(
+    const qtree         *qtree_obj,
+    const void          *low,
+    const void          *high,
+    qtree_visit_func    visitor,
+    void                *context
+);
+void        qtree_interval_stab(
+    const qtree         *qtree_obj,
+    const void          *point,
+    qtree_visit_func    visitor,
+    void                *context
+);
+void        qtree_foreach(const qtree *qtree_obj, qtree_visit_func visitor, void *context);
+size_t      qtree_parallel_foreach(
+    const qtree         *qtree_obj,
+    qtree_visit_func    visitor,
+    void                *contexts[],
+    size_t              thread_count,
+    qtree_reduce_func   reducer
+);
+// Splitting an arena tree copies the nodes of the smaller part, and joining requires
+// two trees with the same callbacks, options and node layout
+qtree_rc    qtree_split(qtree *src, const void *key, qtree *less_tree, qtree *greater_tree);
+qtree_rc    qtree_join(qtree *less_tree, qtree *greater_tree);
+qtree_rc    qtree_compact(qtree *qtree_obj, bool rebalance);
 size_t      qtree_get_size(const qtree *qtree_obj);
 
 #endif	/* QTREE_H */
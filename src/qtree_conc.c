@@ -0,0 +1,416 @@
+/**
+ * qtree with lock-free concurrent readers and a single writer
+ *
+ * @version 2026-10-16_001
+ * @author  Robert Altnoeder (r.altnoeder@gmx.net)
+ *
+ * Copyright (C) 2026 Robert ALTNOEDER
+ *
+ * Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that
+ * the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <sched.h>
+
+#include "qtree_conc.h"
+
+/**
+ * Concurrent reads
+ *
+ * Readers do not take locks. The writer makes the sequence number odd while it
+ * modifies the tree, and even again when it is done. A reader records the
+ * sequence number, traverses the tree, and retries if the sequence number has
+ * changed in the meantime, so a lookup that overlapped with a rotation is
+ * discarded. A reader never writes to shared memory other than its own cache
+ * line sized slot, so lookups on different cores do not contend.
+ *
+ * The tree uses QTREE_OPT_CONCURRENT, so the writer's code in qtree.c stores
+ * every link that a reader may follow with release order, and only after the
+ * linked node has been initialized, while readers load links with acquire
+ * order, so a reader that follows a link during a rotation reaches an
+ * initialized node, even if its path is torn. The keys, values and the size
+ * that readers load are stored atomically as well.
+ *
+ * Removed nodes may still be visited by readers that started earlier, so they
+ * are retired instead of being freed. Readers announce the epoch in which they
+ * started in their slot, and a retired batch of nodes is freed once every
+ * reader that could have seen it has finished.
+ *
+ * Only one thread may call the functions that modify the tree at any time.
+ * Keys and values of removed entries may be freed after the next call of
+ * qtree_conc_synchronize().
+ */
+
+// Longer than any path in an AVL tree, a longer traversal is retried
+#define QTREE_CONC_MAX_STEPS        128
+// Number of retired nodes that triggers an attempt to free retired nodes
+#define QTREE_CONC_RECLAIM_BATCH    64
+
+static inline size_t      qtree_conc_impl_read_begin(qtree_conc *conc_obj);
+static inline bool        qtree_conc_impl_read_end(qtree_conc *conc_obj, size_t seq);
+static inline bool        qtree_conc_impl_find(qtree_conc *conc_obj, const void *key, const void **value);
+static inline void        qtree_conc_impl_write_begin(qtree_conc *conc_obj);
+static inline void        qtree_conc_impl_write_end(qtree_conc *conc_obj);
+static inline void        qtree_conc_impl_reclaim(qtree_conc *conc_obj);
+static inline bool        qtree_conc_impl_quiescent(const qtree_conc *conc_obj, size_t epoch);
+static inline void        qtree_conc_impl_free_list(qtree_node *node);
+static inline void        qtree_conc_impl_init(qtree_conc *conc_obj, qtree_cmp_func cmp_func_ptr);
+
+
+qtree_conc *qtree_conc_alloc(const qtree_cmp_func cmp_func_ptr)
+{
+    qtree_conc *conc_obj = malloc(sizeof (qtree_conc));
+    if (conc_obj != NULL)
+    {
+        qtree_conc_impl_init(conc_obj, cmp_func_ptr);
+    }
+
+    return conc_obj;
+}
+
+
+/**
+ * Frees the tree and all reader slots, no reader may be active
+ */
+void qtree_conc_dealloc(qtree_conc *conc_obj)
+{
+    if (conc_obj != NULL)
+    {
+        qtree_conc_destroy(conc_obj);
+    }
+    free(conc_obj);
+}
+
+
+void qtree_conc_init(qtree_conc *conc_obj, const qtree_cmp_func cmp_func_ptr)
+{
+    qtree_conc_impl_init(conc_obj, cmp_func_ptr);
+}
+
+
+/**
+ * Frees all entries and reader slots of a tree initialized by qtree_conc_init(),
+ * no reader may be active
+ */
+void qtree_conc_destroy(qtree_conc *conc_obj)
+{
+    qtree_clear(&(conc_obj->tree));
+    qtree_conc_impl_free_list(conc_obj->retired);
+    qtree_conc_impl_free_list(conc_obj->limbo);
+    conc_obj->retired       = NULL;
+    conc_obj->retired_count = 0;
+    conc_obj->limbo         = NULL;
+
+    qtree_conc_reader *reader = conc_obj->readers;
+    while (reader != NULL)
+    {
+        qtree_conc_reader *next_reader = reader->next;
+        free(reader);
+        reader = next_reader;
+    }
+    conc_obj->readers = NULL;
+}
+
+
+/**
+ * Removes all entries, waiting for active readers before freeing the nodes
+ */
+void qtree_conc_clear(qtree_conc *conc_obj)
+{
+    qtree detached_tree = conc_obj->tree;
+
+    qtree_conc_impl_write_begin(conc_obj);
+    __atomic_store_n(&(conc_obj->tree.root), NULL, __ATOMIC_RELEASE);
+    conc_obj->tree.min_node = NULL;
+    conc_obj->tree.max_node = NULL;
+    __atomic_store_n(&(conc_obj->tree.size), 0, __ATOMIC_RELAXED);
+    qtree_conc_impl_write_end(conc_obj);
+
+    qtree_conc_synchronize(conc_obj);
+    qtree_clear(&detached_tree);
+}
+
+
+qtree_rc qtree_conc_insert(qtree_conc *conc_obj, const void *key, const void *value)
+{
+    qtree_conc_impl_write_begin(conc_obj);
+    const qtree_rc rc = qtree_insert(&(conc_obj->tree), key, value);
+    qtree_conc_impl_write_end(conc_obj);
+
+    return rc;
+}
+
+
+void qtree_conc_remove(qtree_conc *conc_obj, const void *key)
+{
+    qtree_node *node = qtree_get_node(&(conc_obj->tree), key);
+    if (node != NULL)
+    {
+        qtree_conc_impl_write_begin(conc_obj);
+        qtree_unlink_node(&(conc_obj->tree), node);
+        qtree_conc_impl_write_end(conc_obj);
+
+        // Readers do not follow parent pointers, which link the retired nodes
+        node->parent = conc_obj->retired;
+        conc_obj->retired = node;
+        ++(conc_obj->retired_count);
+        if (conc_obj->retired_count >= QTREE_CONC_RECLAIM_BATCH)
+        {
+            qtree_conc_impl_reclaim(conc_obj);
+        }
+    }
+}
+
+
+/**
+ * Waits until all readers that may still reference removed entries have
+ * finished, and frees all removed nodes
+ */
+void qtree_conc_synchronize(qtree_conc *conc_obj)
+{
+    while (conc_obj->limbo != NULL || conc_obj->retired != NULL)
+    {
+        qtree_conc_impl_reclaim(conc_obj);
+        if (conc_obj->limbo != NULL)
+        {
+            sched_yield();
+        }
+    }
+
+    // Readers of the current epoch may have seen entries removed by qtree_conc_clear()
+    const size_t epoch = __atomic_add_fetch(&(conc_obj->epoch), 1, __ATOMIC_SEQ_CST) - 1;
+    while (!qtree_conc_impl_quiescent(conc_obj, epoch))
+    {
+        sched_yield();
+    }
+}
+
+
+/**
+ * Returns a reader slot for the calling thread
+ *
+ * Each thread that calls qtree_conc_get() needs its own slot. Slots are reused
+ * after they are released, and freed together with the tree.
+ */
+qtree_conc_reader *qtree_conc_reader_alloc(qtree_conc *conc_obj)
+{
+    qtree_conc_reader *reader = __atomic_load_n(&(conc_obj->readers), __ATOMIC_ACQUIRE);
+    while (reader != NULL)
+    {
+        bool in_use = false;
+        if (__atomic_compare_exchange_n(&(reader->in_use), &in_use, true, false,
+            __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+        {
+            break;
+        }
+        reader = reader->next;
+    }
+
+    if (reader == NULL)
+    {
+        reader = malloc(sizeof (qtree_conc_reader));
+        if (reader != NULL)
+        {
+            reader->epoch  = 0;
+            reader->in_use = true;
+            reader->next   = __atomic_load_n(&(conc_obj->readers), __ATOMIC_RELAXED);
+            while (!__atomic_compare_exchange_n(&(conc_obj->readers), &(reader->next), reader, true,
+                __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+            {
+                // reader->next was updated by the failed exchange
+            }
+        }
+    }
+
+    return reader;
+}
+
+
+void qtree_conc_reader_release(qtree_conc_reader *reader)
+{
+    __atomic_store_n(&(reader->in_use), false, __ATOMIC_RELEASE);
+}
+
+
+/**
+ * Looks up a key without locking, concurrently with other readers and the writer
+ */
+void *qtree_conc_get(qtree_conc *conc_obj, qtree_conc_reader *reader, const void *key)
+{
+    // Announce the epoch before the first access to a node
+    __atomic_store_n(&(reader->epoch), __atomic_load_n(&(conc_obj->epoch), __ATOMIC_ACQUIRE), __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    const void *value = NULL;
+    bool valid = false;
+    while (!valid)
+    {
+        const size_t seq = qtree_conc_impl_read_begin(conc_obj);
+        const bool complete = qtree_conc_impl_find(conc_obj, key, &value);
+        valid = qtree_conc_impl_read_end(conc_obj, seq) && complete;
+    }
+
+    __atomic_store_n(&(reader->epoch), 0, __ATOMIC_RELEASE);
+    return (void *) value;
+}
+
+
+size_t qtree_conc_get_size(const qtree_conc *conc_obj)
+{
+    return __atomic_load_n(&(conc_obj->tree.size), __ATOMIC_RELAXED);
+}
+
+
+/**
+ * @return even sequence number at the start of a read
+ */
+static inline size_t qtree_conc_impl_read_begin(qtree_conc *conc_obj)
+{
+    size_t seq = __atomic_load_n(&(conc_obj->seq), __ATOMIC_ACQUIRE);
+    while ((seq & 1) != 0)
+    {
+        seq = __atomic_load_n(&(conc_obj->seq), __ATOMIC_ACQUIRE);
+    }
+    return seq;
+}
+
+
+/**
+ * @return true if the tree was not modified since the start of the read
+ */
+static inline bool qtree_conc_impl_read_end(qtree_conc *conc_obj, const size_t seq)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&(conc_obj->seq), __ATOMIC_RELAXED) == seq;
+}
+
+
+/**
+ * @return false if the traversal did not terminate within the step limit
+ */
+static inline bool qtree_conc_impl_find(qtree_conc *conc_obj, const void *key, const void **value)
+{
+    *value = NULL;
+
+    size_t steps = 0;
+    qtree_node *node = __atomic_load_n(&(conc_obj->tree.root), __ATOMIC_ACQUIRE);
+    while (node != NULL && steps < QTREE_CONC_MAX_STEPS)
+    {
+        const int cmp_rc = conc_obj->tree.qtree_cmp(key, __atomic_load_n(&(node->key), __ATOMIC_RELAXED));
+        if (cmp_rc < 0)
+        {
+            node = __atomic_load_n(&(node->less), __ATOMIC_ACQUIRE);
+        }
+        else
+        if (cmp_rc > 0)
+        {
+            node = __atomic_load_n(&(node->greater), __ATOMIC_ACQUIRE);
+        }
+        else
+        {
+            *value = __atomic_load_n(&(node->value), __ATOMIC_RELAXED);
+            break;
+        }
+        ++steps;
+    }
+
+    return steps < QTREE_CONC_MAX_STEPS;
+}
+
+
+static inline void qtree_conc_impl_write_begin(qtree_conc *conc_obj)
+{
+    __atomic_store_n(&(conc_obj->seq), conc_obj->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+
+static inline void qtree_conc_impl_write_end(qtree_conc *conc_obj)
+{
+    __atomic_store_n(&(conc_obj->seq), conc_obj->seq + 1, __ATOMIC_RELEASE);
+}
+
+
+/**
+ * Frees the limbo batch if no reader can reference it anymore, and moves the
+ * retired nodes into limbo if it is empty
+ */
+static inline void qtree_conc_impl_reclaim(qtree_conc *conc_obj)
+{
+    if (conc_obj->limbo != NULL && qtree_conc_impl_quiescent(conc_obj, conc_obj->limbo_epoch))
+    {
+        qtree_conc_impl_free_list(conc_obj->limbo);
+        conc_obj->limbo = NULL;
+    }
+    if (conc_obj->limbo == NULL && conc_obj->retired != NULL)
+    {
+        // The nodes were unlinked before the epoch advances, readers that
+        // announce a later epoch cannot reach them
+        conc_obj->limbo         = conc_obj->retired;
+        conc_obj->limbo_epoch   = __atomic_add_fetch(&(conc_obj->epoch), 1, __ATOMIC_SEQ_CST) - 1;
+        conc_obj->retired       = NULL;
+        conc_obj->retired_count = 0;
+    }
+}
+
+
+/**
+ * @return true if no reader is active in the specified epoch or an earlier one
+ */
+static inline bool qtree_conc_impl_quiescent(const qtree_conc *conc_obj, const size_t epoch)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    bool quiescent = true;
+    const qtree_conc_reader *reader = __atomic_load_n(&(conc_obj->readers), __ATOMIC_ACQUIRE);
+    while (reader != NULL && quiescent)
+    {
+        const size_t reader_epoch = __atomic_load_n(&(reader->epoch), __ATOMIC_SEQ_CST);
+        quiescent = reader_epoch == 0 || reader_epoch > epoch;
+        reader = reader->next;
+    }
+    return quiescent;
+}
+
+
+static inline void qtree_conc_impl_free_list(qtree_node *node)
+{
+    while (node != NULL)
+    {
+        qtree_node *next_node = node->parent;
+        free(node);
+        node = next_node;
+    }
+}
+
+
+static inline void qtree_conc_impl_init(qtree_conc *conc_obj, const qtree_cmp_func cmp_func_ptr)
+{
+    qtree_init_opt(&(conc_obj->tree), cmp_func_ptr, QTREE_OPT_CONCURRENT);
+    conc_obj->seq           = 0;
+    conc_obj->epoch         = 1;
+    conc_obj->readers       = NULL;
+    conc_obj->retired       = NULL;
+    conc_obj->retired_count = 0;
+    conc_obj->limbo         = NULL;
+    conc_obj->limbo_epoch   = 0;
+}
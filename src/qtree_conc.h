@@ -0,0 +1,53 @@
+#ifndef QTREE_CONC_H
+#define	QTREE_CONC_H
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "qtree.h"
+
+#define QTREE_CONC_CACHE_LINE 64
+
+typedef struct qtree_conc_s         qtree_conc;
+typedef struct qtree_conc_reader_s  qtree_conc_reader;
+
+struct qtree_conc_s
+{
+    qtree               tree;
+    size_t              seq;
+    size_t              epoch;
+    qtree_conc_reader   *readers;
+    qtree_node          *retired;
+    size_t              retired_count;
+    qtree_node          *limbo;
+    size_t              limbo_epoch;
+};
+
+struct qtree_conc_reader_s
+{
+    size_t              epoch;
+    bool                in_use;
+    qtree_conc_reader   *next;
+    unsigned char       padding[QTREE_CONC_CACHE_LINE];
+};
+
+void                qtree_conc_dealloc(qtree_conc *conc_obj);
+void                qtree_conc_clear(qtree_conc *conc_obj);
+qtree_conc          *qtree_conc_alloc(qtree_cmp_func cmp_func_ptr);
+void                qtree_conc_init(qtree_conc *conc_obj, qtree_cmp_func cmp_func_ptr);
+void                qtree_conc_destroy(qtree_conc *conc_obj);
+qtree_rc            qtree_conc_insert(
+    qtree_conc  *conc_obj,
+    const void  *key,
+    const void  *value
+);
+void                qtree_conc_remove(qtree_conc *conc_obj, const void *key);
+void                qtree_conc_synchronize(qtree_conc *conc_obj);
+qtree_conc_reader   *qtree_conc_reader_alloc(qtree_conc *conc_obj);
+void                qtree_conc_reader_release(qtree_conc_reader *reader);
+void                *qtree_conc_get(qtree_conc *conc_obj, qtree_conc_reader *reader, const void *key);
+size_t              qtree_conc_get_size(const qtree_conc *conc_obj);
+
+#endif	/* QTREE_CONC_H */
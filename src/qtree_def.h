@@ -0,0 +1,1117 @@
+#ifndef QTREE_DEF_H
+#define	QTREE_DEF_H
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "qtree.h"
+
+/**
+ * Generator for type-specialized qtree variants
+ *
+ * The generated tree stores keys of type key_type inline in its nodes and compares
+ * them using cmp_macro(key_alpha, key_bravo), which must evaluate to a negative
+ * value, zero or a positive value like a qtree_cmp_func. Apart from taking keys
+ * by value and not using a comparison function, the API of the generated
+ * name_... functions matches the API of qtree.h.
+ *
+ * QTREE_DECLARE(name, key_type) declares the types and functions,
+ * QTREE_DEFINE(name, key_type, cmp_macro) defines the functions in exactly one
+ * translation unit, e.g.:
+ *
+ * QTREE_DECLARE(qtree_u64, uint64_t)
+ * QTREE_DEFINE(qtree_u64, uint64_t, QTREE_CMP_SCALAR)
+ */
+
+typedef enum
+{
+    QTREE_DEF_DIR_LESS    = 0,
+    QTREE_DEF_DIR_GREATER = 1
+}
+qtree_def_dir;
+
+#define QTREE_CMP_SCALAR(key_alpha, key_bravo) \
+    ((key_alpha) < (key_bravo) ? -1 : ((key_alpha) > (key_bravo) ? 1 : 0))
+
+#define QTREE_DECLARE(name, key_type)                                                      \
+typedef struct name##_s      name;                                                         \
+typedef struct name##_node_s name##_node;                                                  \
+typedef struct name##_it_s   name##_it;                                                    \
+                                                                                           \
+struct name##_s                                                                            \
+{                                                                                          \
+    name##_node *root;                                                                     \
+    size_t      size;                                                                      \
+};                                                                                         \
+                                                                                           \
+struct name##_node_s                                                                       \
+{                                                                                          \
+    key_type    key;                                                                       \
+    const void  *value;                                                                    \
+    name##_node *less;                                                                     \
+    name##_node *greater;                                                                  \
+    name##_node *parent;                                                                   \
+    int         balance;                                                                   \
+};                                                                                         \
+                                                                                           \
+struct name##_it_s                                                                         \
+{                                                                                          \
+    name##_node *next;                                                                     \
+};                                                                                         \
+                                                                                           \
+void        name##_dealloc(name *tree_obj);                                                \
+void        name##_clear(name *tree_obj);                                                  \
+name        *name##_alloc(void);                                                           \
+void        name##_init(name *tree_obj);                                                   \
+qtree_rc    name##_insert(                                                                 \
+    name        *tree_obj,                                                                 \
+    key_type    key,                                                                       \
+    const void  *value                                                                     \
+);                                                                                         \
+qtree_rc    name##_insert_node(name *tree_obj, name##_node *node);                         \
+void        name##_remove(name *tree_obj, key_type key);                                   \
+void        name##_remove_node(name *tree_obj, name##_node *node);                         \
+void        name##_unlink_node(name *tree_obj, name##_node *node);                         \
+void        *name##_get(const name *tree_obj, key_type key);                               \
+name##_node *name##_get_node(const name *tree_obj, key_type key);                          \
+name##_it   *name##_iterator(const name *tree_obj);                                        \
+void        name##_iterator_init(const name *tree_obj, name##_it *iter);                   \
+name##_node *name##_next(name##_it *iter);                                                 \
+size_t      name##_get_size(const name *tree_obj);
+
+#define QTREE_DEFINE(name, key_type, cmp_macro)                                            \
+static inline name##_node *name##_impl_find_node(const name *tree_obj, key_type key);      \
+static inline qtree_rc   name##_impl_insert_node(name *tree_obj, name##_node *ins_node);   \
+static inline void       name##_impl_remove_node(name *tree_obj, name##_node *rm_node);    \
+static inline void       name##_impl_unlink_node(name *tree_obj, name##_node *rm_node);    \
+static inline void       name##_impl_rebalance_insert(                                     \
+    name        *tree_obj,                                                                 \
+    name##_node *sub_node,                                                                 \
+    name##_node *rot_node                                                                  \
+);                                                                                         \
+static inline void       name##_impl_rebalance_remove(                                     \
+    name          *tree_obj,                                                               \
+    qtree_def_dir dir,                                                                     \
+    name##_node   *rot_node                                                                \
+);                                                                                         \
+static inline void       name##_impl_init(name *tree_obj);                                 \
+static inline void       name##_impl_iterator_init(const name *tree_obj, name##_it *iter); \
+static inline void       name##_impl_clear(name *tree_obj);                                \
+                                                                                           \
+                                                                                           \
+name *name##_alloc(void)                                                                   \
+{                                                                                          \
+    name *tree_obj = malloc(sizeof (name));                                                \
+    if (tree_obj != NULL)                                                                  \
+    {                                                                                      \
+        name##_impl_init(tree_obj);                                                        \
+    }                                                                                      \
+                                                                                           \
+    return tree_obj;                                                                       \
+}                                                                                          \
+                                                                                           \
+                                                                                           \
+void name##_dealloc(name *tree_obj)                                                        \
+{                                                                                          \
+    name##_impl_clear(tree_obj);                                                           \
+    free(tree_obj);                                                                        \
+}                                                                                          \
+                                                                                           \
+                                                                                           \
+void name##_clear(name *tree_obj)                                                          \
+{                                                                                          \
+    name##_impl_clear(tree_obj);                                                           \
+    tree_obj->size = 0;                                                                    \
+    tree_obj->root = NULL;                                                                 \
+}                                                                                          \
+                                                                                           \
+                                                                                           \
+void name##_init(name *tree_obj)                                                           \
+{                                                                                          \
+    name##_impl_init(tree_obj);                                                            \
+}                                                                                          \
+                                                                                           \
+                                                                                           \
+qtree_rc name##_insert(name *tree_obj, const key_type key, const void *value_ptr)          \
+{                                                                                          \
+    qtree_rc rc = QTREE_PASS;                                                              \
+                                                                                           \
+    name##_node **ref_ins_node = NULL;                                                     \
+    name##_node *parent_node = NULL;                                                       \
+                                                                                           \
+    if (tree_obj->root == NULL)                                                            \
+    {                                                                                      \
+        ref_ins_node = &tree_obj->root;                                                    \
+    }                                                                                      \
+    else                                                                                   \
+    {                                                                                      \
+        parent_node = tree_obj->root;                                                      \
+        while (true)                                                                       \
+        {                                                                                  \
+            const int cmp_rc = cmp_macro(key, parent_node->key);                           \
+            if (cmp_rc < 0)                                                                \
+            {                                                                              \
+                if (parent_node->less == NULL)                                             \
+                {                                                                          \
+                    ref_ins_node = &parent_node->less;                                     \
+                    break;                                                                 \
+                }                                                                          \
+                else                                                                       \
+                {                                                                          \
+                    parent_node = parent_node->less;                                       \
+                }                                                                          \
+            }                                                                              \
+            else                                                                           \
+            if (cmp_rc > 0)                                                                \
+            {                                                                              \
+                if (parent_node->greater == NULL)                                          \
+                {                                                                          \
+                    ref_ins_node = &parent_node->greater;                                  \
+                    break;                                                                 \
+                }                                                                          \
+                else                                                                       \
+                {                                                                          \
+                    parent_node = parent_node->greater;                                    \
+                }                                                                          \
+            }                                                                              \
+            else                                                                           \
+            {                                                                              \
+                rc = QTREE_ERR_EXISTS;                                                     \
+                break;                                                                     \
+            }                                                                              \
+        }                                                                                  \
+    }                                                                                      \
+                                                                                           \
+    if (ref_ins_node != NULL)                                                              \
+    {                                                                                      \
+        name##_node *ins_node = malloc(sizeof (name##_node));                              \
+        if (ins_node != NULL)                                                              \
+        {                                                                                  \
+            *ref_ins_node     = ins_node;                                                  \
+            ins_node->key     = key;                                                       \
+            ins_node->value   = value_ptr;                                                 \
+            ins_node->parent  = parent_node;                                               \
+            ins_node->less    = NULL;                                                      \
+            ins_node->greater = NULL;                                                      \
+            ins_node->balance = 0;                                                         \
+            ++(tree_obj->size);                                                            \
+            if (parent_node != NULL)                                                       \
+            {                                                                              \
+                name##_impl_rebalance_insert(tree_obj, ins_node, parent_node);             \
+            }                                                                              \
+        }                                                                                  \
+        else                                                                               \
+        {                                                                                  \
+            rc = QTREE_ERR_NOMEM;                                                          \
+        }                                                                                  \
+    }                                                                                      \
+                                                                                           \
+    return rc;                                                                             \
+}                                                                                          \
+                                                                                           \
+                                                                                           \
+qtree_rc name##_insert_node(name *tree_obj, name##_node *node)                             \
+{                                                                                          \
+    return name##_impl_insert_node(tree_obj, node);                                        \
+}                                                                                          \
+                                                                                           \
+                                                                                           \
+void name##_remove(name *tree_obj, const key_type key)                                     \
+{                                                                                          \
+    name##_node *node = name##_impl_find_node(tree_obj, key);                              \
+    if (node != NULL)                                                                      \
+    {                                                                                      \
+        name##_impl_remove_node(tree_obj, node);                                           \
+    }                                                                                      \
+}                                                                                          \
+                                                                                           \
+                                                                                           \
+void name##_remove_node(name *tree_obj, name##_node *node)                                 \
+{                                                                                          \
+    name##_impl_remove_node(tree_obj, node);                                               \
+}                                                                                          \
+                                                                                           \
+                                                                                           \
+void name##_unlink_node(name *tree_obj, name##_node *node)                                 \
+{                                                                                          \
+    name##_impl_unlink_node(tree_obj, node);                                               \
+}                                                                                          \
+                                                                                           \
+                                                                                           \
+void *name##_get(const name *tree_obj, const key_type key)                                 \
+{                                                                                          \
+    const void *value = NULL;                                                              \
+    name##_node *node  = name##_impl_find_node(tree_obj, key);                             \
+    if (node != NULL)                                                                      \
+    {                                                                                      \
+        value = node->value;                                                               \
+    }                                                                                      \
+    return (void *) value;                                                                 \
+}                                                                                          \
+                                                                                           \
+                                                                                           \
+name##_node *name##_get_node(const name *tree_obj, const key_type key)                     \
+{                                                                                          \
+    return name##_impl_find_node(tree_obj, key);                                           \
+}                                                                                          \
+                                                                                           \
+                                                                                           \
+size_t name##_get_size(const name *tree_obj)                                               \
+{                                                                                          \
+    return tree_obj->size;                                                                 \
+}                                                                                          \
+                                                                                           \
+                                                                                           \
+name##_it *name##_iterator(const name *tree_obj)                                           \
+{                                                                                          \
+    name##_it *iter = malloc(sizeof (name##_it));                                          \
+    if (iter != NULL)                                                                      \
+    {                                                                                      \
+        name##_impl_iterator_init(tree_obj, iter);                                         \
+    }                                                                                      \
+    return iter;                                                                           \
+}                                                                                          \
+                                                                                           \
+                                                                                           \
+void name##_iterator_init(const name *tree_obj, name##_it *iter)                           \
+{                                                                                          \
+    name##_impl_iterator_init(tree_obj, iter);                                             \
+}                                                                                          \
+                                                                                           \
+                                                                                           \
+name##_node *name##_next(name##_it *iter)                                                  \
+{                                                                                          \
+    name##_node *ret_node = iter->next;                                                    \
+                                                                                           \
+    if (ret_node != NULL)                                                                  \
+    {                                                                                      \
+        name##_node *next_node = ret_node;                                                 \
+        if (next_node->greater != NULL)                                                    \
+        {                                                                                  \
+            next_node = next_node->greater;                                                \
+            while (next_node->less != NULL)                                                \
+            {                                                                              \
+                next_node = next_node->less;                                               \
+            }                                                                              \
+        }                                                                                  \
+        else                                                                               \
+        {                                                                                  \
+            do                                                                             \
+            {                                                                              \
+                if (next_node->parent != NULL)                                             \
+                {                                                                          \
+                    if (next_node->parent->less == next_node)                              \
+                    {                                                                      \
+                        next_node = next_node->parent;                                     \
+                        break;                                                             \
+                    }                                                                      \
+                }                                                                          \
+                next_node = next_node->parent;                                             \
+            }                                                                              \
+            while (next_node != NULL);                                                     \
+        }                                                                                  \
+        iter->next = next_node;                                                            \
+    }                                                                                      \
+                                                                                           \
+    return ret_node;                                                                       \
+}                                                                                          \
+                                                                                           \
+                                                                                           \
+/**                                                                                        \
+ * Rebalances the tree after node removal                                                  \
+ *                                                                                         \
+ * WARNING! The order of statements, especially assignments, in this function              \
+ *          is critical for the function's correct operation.                              \
+ *          DO NOT CHANGE THE ORDER OF ANY STATEMENTS.                                     \
+ */                                                                                        \
+static inline void name##_impl_rebalance_remove(                                           \
+    name       *tree_obj,                                                                  \
+    qtree_def_dir   dir,                                                                   \
+    name##_node  *rot_node                                                                 \
+)                                                                                          \
+{                                                                                          \
+    /* update balance and perform rotations */                                             \
+    while (rot_node != NULL)                                                               \
+    {                                                                                      \
+        if (dir == QTREE_DEF_DIR_LESS)                                                     \
+        {                                                                                  \
+            /* node was removed from left subtree */                                       \
+            ++rot_node->balance;                                                           \
+            if (rot_node->balance == 1)                                                    \
+            {                                                                              \
+                break;                                                                     \
+            }                                                                              \
+        }                                                                                  \
+        else                                                                               \
+        {                                                                                  \
+            /* node was removed from right subtree */                                      \
+            --rot_node->balance;                                                           \
+            if (rot_node->balance == -1)                                                   \
+            {                                                                              \
+                break;                                                                     \
+            }                                                                              \
+        }                                                                                  \
+                                                                                           \
+        if (rot_node->parent != NULL)                                                      \
+        {                                                                                  \
+            if (rot_node->parent->less == rot_node)                                        \
+            {                                                                              \
+                dir = QTREE_DEF_DIR_LESS;                                                  \
+            }                                                                              \
+            else                                                                           \
+            {                                                                              \
+                dir = QTREE_DEF_DIR_GREATER;                                               \
+            }                                                                              \
+        }                                                                                  \
+                                                                                           \
+        /* update balance and perform rotations */                                         \
+        if (rot_node->balance == -2)                                                       \
+        {                                                                                  \
+            name##_node *sub_node = rot_node->less;                                        \
+            /* 0 or -1 */                                                                  \
+            if (sub_node->balance <= 0)                                                    \
+            {                                                                              \
+                /* rotate R */                                                             \
+                sub_node->parent = rot_node->parent;                                       \
+                if (rot_node->parent != NULL)                                              \
+                {                                                                          \
+                    if (rot_node->parent->less == rot_node)                                \
+                    {                                                                      \
+                        rot_node->parent->less = sub_node;                                 \
+                    }                                                                      \
+                    else                                                                   \
+                    {                                                                      \
+                        rot_node->parent->greater = sub_node;                              \
+                    }                                                                      \
+                }                                                                          \
+                else                                                                       \
+                {                                                                          \
+                    tree_obj->root = sub_node;                                             \
+                }                                                                          \
+                                                                                           \
+                rot_node->less = sub_node->greater;                                        \
+                if (sub_node->greater != NULL)                                             \
+                {                                                                          \
+                    sub_node->greater->parent = rot_node;                                  \
+                }                                                                          \
+                                                                                           \
+                sub_node->greater = rot_node;                                              \
+                rot_node->parent  = sub_node;                                              \
+                                                                                           \
+                if (sub_node->balance == 0)                                                \
+                {                                                                          \
+                    rot_node->balance = -1;                                                \
+                    sub_node->balance = 1;                                                 \
+                    break;                                                                 \
+                }                                                                          \
+                else                                                                       \
+                {                                                                          \
+                    rot_node->balance = 0;                                                 \
+                    sub_node->balance = 0;                                                 \
+                }                                                                          \
+            }                                                                              \
+            else                                                                           \
+            {                                                                              \
+                /* rotate LR */                                                            \
+                if (sub_node->greater->balance == -1)                                      \
+                {                                                                          \
+                    sub_node->balance = 0;                                                 \
+                    rot_node->balance = 1;                                                 \
+                }                                                                          \
+                else                                                                       \
+                if (sub_node->greater->balance == 1)                                       \
+                {                                                                          \
+                    sub_node->balance = -1;                                                \
+                    rot_node->balance = 0;                                                 \
+                }                                                                          \
+                else                                                                       \
+                {                                                                          \
+                    sub_node->balance = 0;                                                 \
+                    rot_node->balance = 0;                                                 \
+                }                                                                          \
+                sub_node->greater->balance = 0;                                            \
+                                                                                           \
+                sub_node->parent         = sub_node->greater;                              \
+                sub_node->greater        = sub_node->greater->less;                        \
+                sub_node->parent->less   = sub_node;                                       \
+                rot_node->less           = sub_node->parent->greater;                      \
+                sub_node->parent->parent = rot_node->parent;                               \
+                if (sub_node->greater != NULL)                                             \
+                {                                                                          \
+                    sub_node->greater->parent = sub_node;                                  \
+                }                                                                          \
+                if (rot_node->less != NULL)                                                \
+                {                                                                          \
+                    rot_node->less->parent = rot_node;                                     \
+                }                                                                          \
+                                                                                           \
+                if (rot_node->parent != NULL)                                              \
+                {                                                                          \
+                    if (rot_node->parent->less == rot_node)                                \
+                    {                                                                      \
+                        rot_node->parent->less = sub_node->parent;                         \
+                    }                                                                      \
+                    else                                                                   \
+                    {                                                                      \
+                        rot_node->parent->greater = sub_node->parent;                      \
+                    }                                                                      \
+                }                                                                          \
+                else                                                                       \
+                {                                                                          \
+                    tree_obj->root = sub_node->parent;                                     \
+                }                                                                          \
+                                                                                           \
+                rot_node->parent          = sub_node->parent;                              \
+                sub_node->parent->greater = rot_node;                                      \
+            }                                                                              \
+            rot_node = rot_node->parent;                                                   \
+            /* end of R / LR rotations */                                                  \
+        }                                                                                  \
+        else                                                                               \
+        if (rot_node->balance == 2)                                                        \
+        {                                                                                  \
+            name##_node *sub_node = rot_node->greater;                                     \
+            /* 0 or 1 */                                                                   \
+            if (sub_node->balance >= 0)                                                    \
+            {                                                                              \
+                /* rotate L */                                                             \
+                sub_node->parent = rot_node->parent;                                       \
+                if (rot_node->parent != NULL)                                              \
+                {                                                                          \
+                    if (rot_node->parent->less == rot_node)                                \
+                    {                                                                      \
+                        rot_node->parent->less = sub_node;                                 \
+                    }                                                                      \
+                    else                                                                   \
+                    {                                                                      \
+                        rot_node->parent->greater = sub_node;                              \
+                    }                                                                      \
+                }                                                                          \
+                else                                                                       \
+                {                                                                          \
+                    tree_obj->root = sub_node;                                             \
+                }                                                                          \
+                                                                                           \
+                rot_node->greater = sub_node->less;                                        \
+                if (sub_node->less != NULL)                                                \
+                {                                                                          \
+                    sub_node->less->parent = rot_node;                                     \
+                }                                                                          \
+                                                                                           \
+                sub_node->less   = rot_node;                                               \
+                rot_node->parent = sub_node;                                               \
+                if (sub_node->balance == 0)                                                \
+                {                                                                          \
+                    rot_node->balance = 1;                                                 \
+                    sub_node->balance = -1;                                                \
+                    break;                                                                 \
+                }                                                                          \
+                else                                                                       \
+                {                                                                          \
+                    rot_node->balance = 0;                                                 \
+                    sub_node->balance = 0;                                                 \
+                }                                                                          \
+            }                                                                              \
+            else                                                                           \
+            {                                                                              \
+                /* rotate RL */                                                            \
+                if (sub_node->less->balance == -1)                                         \
+                {                                                                          \
+                    sub_node->balance = 1;                                                 \
+                    rot_node->balance = 0;                                                 \
+                }                                                                          \
+                else                                                                       \
+                if (sub_node->less->balance == 1)                                          \
+                {                                                                          \
+                    sub_node->balance = 0;                                                 \
+                    rot_node->balance = -1;                                                \
+                }                                                                          \
+                else                                                                       \
+                {                                                                          \
+                    sub_node->balance = 0;                                                 \
+                    rot_node->balance = 0;                                                 \
+                }                                                                          \
+                sub_node->less->balance = 0;                                               \
+                                                                                           \
+                sub_node->parent          = sub_node->less;                                \
+                sub_node->less            = sub_node->less->greater;                       \
+                sub_node->parent->greater = sub_node;                                      \
+                rot_node->greater         = sub_node->parent->less;                        \
+                sub_node->parent->parent  = rot_node->parent;                              \
+                if (sub_node->less != NULL)                                                \
+                {                                                                          \
+                    sub_node->less->parent = sub_node;                                     \
+                }                                                                          \
+                if (rot_node->greater != NULL)                                             \
+                {                                                                          \
+                    rot_node->greater->parent = rot_node;                                  \
+                }                                                                          \
+                                                                                           \
+                if (rot_node->parent != NULL)                                              \
+                {                                                                          \
+                    if (rot_node->parent->less == rot_node)                                \
+                    {                                                                      \
+                        rot_node->parent->less = sub_node->parent;                         \
+                    }                                                                      \
+                    else                                                                   \
+                    {                                                                      \
+                        rot_node->parent->greater = sub_node->parent;                      \
+                    }                                                                      \
+                }                                                                          \
+                else                                                                       \
+                {                                                                          \
+                    tree_obj->root = sub_node->parent;                                     \
+                }                                                                          \
+                                                                                           \
+                rot_node->parent       = sub_node->parent;                                 \
+                sub_node->parent->less = rot_node;                                         \
+            }                                                                              \
+            rot_node = rot_node->parent;                                                   \
+            /* end of L / RL rotations */                                                  \
+        }                                                                                  \
+        rot_node = rot_node->parent;                                                       \
+    }                                                                                      \
+}                                                                                          \
+                                                                                           \
+                                                                                           \
+/**                                                                                        \
+ * Rebalances the tree after node insertion                                                \
+ *                                                                                         \
+ * WARNING! The order of statements, especially assignments, in this function              \
+ *          is critical for the function's correct operation.                              \
+ *          DO NOT CHANGE THE ORDER OF ANY STATEMENTS.                                     \
+ */                                                                                        \
+static inline void name##_impl_rebalance_insert(                                           \
+    name      *tree_obj,                                                                   \
+    name##_node *sub_node,                                                                 \
+    name##_node *rot_node                                                                  \
+)                                                                                          \
+{                                                                                          \
+    /* update balance and perform rotations */                                             \
+    do                                                                                     \
+    {                                                                                      \
+        if (rot_node->less == sub_node)                                                    \
+        {                                                                                  \
+            --(rot_node->balance);                                                         \
+        }                                                                                  \
+        else                                                                               \
+        {                                                                                  \
+            ++(rot_node->balance);                                                         \
+        }                                                                                  \
+                                                                                           \
+        if (rot_node->balance == 0)                                                        \
+        {                                                                                  \
+            break;                                                                         \
+        }                                                                                  \
+        else                                                                               \
+        if (rot_node->balance == -2)                                                       \
+        {                                                                                  \
+            if (sub_node->balance == -1)                                                   \
+            {                                                                              \
+                /* rotate R */                                                             \
+                rot_node->balance = 0;                                                     \
+                sub_node->balance = 0;                                                     \
+                                                                                           \
+                sub_node->parent = rot_node->parent;                                       \
+                if (rot_node->parent != NULL)                                              \
+                {                                                                          \
+                    if (rot_node->parent->less == rot_node)                                \
+                    {                                                                      \
+                        rot_node->parent->less = sub_node;                                 \
+                    }                                                                      \
+                    else                                                                   \
+                    {                                                                      \
+                        rot_node->parent->greater = sub_node;                              \
+                    }                                                                      \
+                }                                                                          \
+                else                                                                       \
+                {                                                                          \
+                    tree_obj->root = sub_node;                                             \
+                }                                                                          \
+                                                                                           \
+                rot_node->less = sub_node->greater;                                        \
+                if (sub_node->greater != NULL)                                             \
+                {                                                                          \
+                    sub_node->greater->parent = rot_node;                                  \
+                }                                                                          \
+                                                                                           \
+                sub_node->greater = rot_node;                                              \
+                rot_node->parent = sub_node;                                               \
+            }                                                                              \
+            else                                                                           \
+            {                                                                              \
+                /* rotate LR */                                                            \
+                if (sub_node->greater->balance == -1)                                      \
+                {                                                                          \
+                    sub_node->balance = 0;                                                 \
+                    rot_node->balance = 1;                                                 \
+                }                                                                          \
+                else                                                                       \
+                if (sub_node->greater->balance == 1)                                       \
+                {                                                                          \
+                    sub_node->balance = -1;                                                \
+                    rot_node->balance = 0;                                                 \
+                }                                                                          \
+                else                                                                       \
+                {                                                                          \
+                    sub_node->balance = 0;                                                 \
+                    rot_node->balance = 0;                                                 \
+                }                                                                          \
+                sub_node->greater->balance = 0;                                            \
+                                                                                           \
+                sub_node->parent         = sub_node->greater;                              \
+                sub_node->greater        = sub_node->greater->less;                        \
+                sub_node->parent->less   = sub_node;                                       \
+                rot_node->less           = sub_node->parent->greater;                      \
+                sub_node->parent->parent = rot_node->parent;                               \
+                if (sub_node->greater != NULL)                                             \
+                {                                                                          \
+                    sub_node->greater->parent = sub_node;                                  \
+                }                                                                          \
+                if (rot_node->less != NULL)                                                \
+                {                                                                          \
+                    rot_node->less->parent = rot_node;                                     \
+                }                                                                          \
+                                                                                           \
+                if (rot_node->parent != NULL)                                              \
+                {                                                                          \
+                    if (rot_node->parent->less == rot_node)                                \
+                    {                                                                      \
+                        rot_node->parent->less = sub_node->parent;                         \
+                    }                                                                      \
+                    else                                                                   \
+                    {                                                                      \
+                        rot_node->parent->greater = sub_node->parent;                      \
+                    }                                                                      \
+                }                                                                          \
+                else                                                                       \
+                {                                                                          \
+                    tree_obj->root = sub_node->parent;                                     \
+                }                                                                          \
+                                                                                           \
+                rot_node->parent          = sub_node->parent;                              \
+                sub_node->parent->greater = rot_node;                                      \
+            }                                                                              \
+            break;                                                                         \
+        }                                                                                  \
+        else                                                                               \
+        if (rot_node->balance == 2)                                                        \
+        {                                                                                  \
+            if (sub_node->balance == 1)                                                    \
+            {                                                                              \
+                /* rotate L */                                                             \
+                rot_node->balance = 0;                                                     \
+                sub_node->balance = 0;                                                     \
+                                                                                           \
+                sub_node->parent = rot_node->parent;                                       \
+                if (rot_node->parent != NULL)                                              \
+                {                                                                          \
+                    if (rot_node->parent->less == rot_node)                                \
+                    {                                                                      \
+                        rot_node->parent->less = sub_node;                                 \
+                    }                                                                      \
+                    else                                                                   \
+                    {                                                                      \
+                        rot_node->parent->greater = sub_node;                              \
+                    }                                                                      \
+                }                                                                          \
+                else                                                                       \
+                {                                                                          \
+                    tree_obj->root = sub_node;                                             \
+                }                                                                          \
+                                                                                           \
+                rot_node->greater = sub_node->less;                                        \
+                if (sub_node->less != NULL)                                                \
+                {                                                                          \
+                    sub_node->less->parent = rot_node;                                     \
+                }                                                                          \
+                                                                                           \
+                sub_node->less = rot_node;                                                 \
+                rot_node->parent = sub_node;                                               \
+            }                                                                              \
+            else                                                                           \
+            {                                                                              \
+                /* rotate RL */                                                            \
+                if (sub_node->less->balance == -1)                                         \
+                {                                                                          \
+                    sub_node->balance = 1;                                                 \
+                    rot_node->balance = 0;                                                 \
+                }                                                                          \
+                else                                                                       \
+                if (sub_node->less->balance == 1)                                          \
+                {                                                                          \
+                    sub_node->balance = 0;                                                 \
+                    rot_node->balance = -1;                                                \
+                }                                                                          \
+                else                                                                       \
+                {                                                                          \
+                    sub_node->balance = 0;                                                 \
+                    rot_node->balance = 0;                                                 \
+                }                                                                          \
+                sub_node->less->balance = 0;                                               \
+                                                                                           \
+                sub_node->parent          = sub_node->less;                                \
+                sub_node->less            = sub_node->less->greater;                       \
+                sub_node->parent->greater = sub_node;                                      \
+                rot_node->greater         = sub_node->parent->less;                        \
+                sub_node->parent->parent  = rot_node->parent;                              \
+                if (sub_node->less != NULL)                                                \
+                {                                                                          \
+                    sub_node->less->parent = sub_node;                                     \
+                }                                                                          \
+                if (rot_node->greater != NULL)                                             \
+                {                                                                          \
+                    rot_node->greater->parent = rot_node;                                  \
+                }                                                                          \
+                                                                                           \
+                if (rot_node->parent != NULL)                                              \
+                {                                                                          \
+                    if (rot_node->parent->less == rot_node)                                \
+                    {                                                                      \
+                        rot_node->parent->less = sub_node->parent;                         \
+                    }                                                                      \
+                    else                                                                   \
+                    {                                                                      \
+                        rot_node->parent->greater = sub_node->parent;                      \
+                    }                                                                      \
+                }                                                                          \
+                else                                                                       \
+                {                                                                          \
+                    tree_obj->root = sub_node->parent;                                     \
+                }                                                                          \
+                                                                                           \
+                rot_node->parent       = sub_node->parent;                                 \
+                sub_node->parent->less = rot_node;                                         \
+            }                                                                              \
+            break;                                                                         \
+        }                                                                                  \
+                                                                                           \
+        sub_node = rot_node;                                                               \
+        rot_node = rot_node->parent;                                                       \
+    }                                                                                      \
+    while (rot_node != NULL);                                                              \
+}                                                                                          \
+                                                                                           \
+                                                                                           \
+static inline qtree_rc name##_impl_insert_node(name *tree_obj, name##_node *ins_node)      \
+{                                                                                          \
+    qtree_rc rc = QTREE_PASS;                                                              \
+                                                                                           \
+    if (tree_obj->root == NULL)                                                            \
+    {                                                                                      \
+        tree_obj->root   = ins_node;                                                       \
+        ins_node->less    = NULL;                                                          \
+        ins_node->greater = NULL;                                                          \
+        ins_node->parent  = NULL;                                                          \
+        ins_node->balance = 0;                                                             \
+        ++(tree_obj->size);                                                                \
+    }                                                                                      \
+    else                                                                                   \
+    {                                                                                      \
+        name##_node *parent_node = tree_obj->root;                                         \
+        while (true)                                                                       \
+        {                                                                                  \
+            const int cmp_rc = cmp_macro(ins_node->key, parent_node->key);                 \
+            if (cmp_rc < 0)                                                                \
+            {                                                                              \
+                if (parent_node->less == NULL)                                             \
+                {                                                                          \
+                    parent_node->less = ins_node;                                          \
+                    ins_node->parent  = parent_node;                                       \
+                    ins_node->less    = NULL;                                              \
+                    ins_node->greater = NULL;                                              \
+                    ins_node->balance = 0;                                                 \
+                    ++(tree_obj->size);                                                    \
+                    name##_impl_rebalance_insert(tree_obj, ins_node, parent_node);         \
+                    break;                                                                 \
+                }                                                                          \
+                else                                                                       \
+                {                                                                          \
+                    parent_node = parent_node->less;                                       \
+                }                                                                          \
+            }                                                                              \
+            else                                                                           \
+            if (cmp_rc > 0)                                                                \
+            {                                                                              \
+                if (parent_node->greater == NULL)                                          \
+                {                                                                          \
+                    parent_node->greater = ins_node;                                       \
+                    ins_node->parent     = parent_node;                                    \
+                    ins_node->less       = NULL;                                           \
+                    ins_node->greater    = NULL;                                           \
+                    ins_node->balance    = 0;                                              \
+                    ++(tree_obj->size);                                                    \
+                    name##_impl_rebalance_insert(tree_obj, ins_node, parent_node);         \
+                    break;                                                                 \
+                }                                                                          \
+                else                                                                       \
+                {                                                                          \
+                    parent_node = parent_node->greater;                                    \
+                }                                                                          \
+            }                                                                              \
+            else                                                                           \
+            {                                                                              \
+                rc = QTREE_ERR_EXISTS;                                                     \
+                break;                                                                     \
+            }                                                                              \
+        }                                                                                  \
+    }                                                                                      \
+                                                                                           \
+    return rc;                                                                             \
+}                                                                                          \
+                                                                                           \
+                                                                                           \
+static inline void name##_impl_remove_node(name *tree_obj, name##_node *crt)               \
+{                                                                                          \
+    name##_impl_unlink_node(tree_obj, crt);                                                \
+    free(crt);                                                                             \
+}                                                                                          \
+                                                                                           \
+                                                                                           \
+static inline void name##_impl_unlink_node(name *tree_obj, name##_node *rm_node)           \
+{                                                                                          \
+    --(tree_obj->size);                                                                    \
+                                                                                           \
+    if (rm_node->less == NULL && rm_node->greater == NULL)                                 \
+    {                                                                                      \
+        /* leaf node - removal without replacement */                                      \
+        if (tree_obj->root == rm_node)                                                     \
+        {                                                                                  \
+            /* root node leaf */                                                           \
+            tree_obj->root = NULL;                                                         \
+        }                                                                                  \
+        else                                                                               \
+        {                                                                                  \
+            /* non-root node leaf */                                                       \
+            name##_node *rot_node = rm_node->parent;                                       \
+            qtree_def_dir  dir;                                                            \
+            if (rot_node->less == rm_node)                                                 \
+            {                                                                              \
+                /* node to remove is in the left subtree */                                \
+                /* of its parent */                                                        \
+                                                                                           \
+                /* save direction */                                                       \
+                dir = QTREE_DEF_DIR_LESS;                                                  \
+                rot_node->less = NULL;                                                     \
+            }                                                                              \
+            else                                                                           \
+            {                                                                              \
+                /* node to remove is in the right subtree */                               \
+                /* of its parent */                                                        \
+                                                                                           \
+                /* save direction */                                                       \
+                dir = QTREE_DEF_DIR_GREATER;                                               \
+                rot_node->greater = NULL;                                                  \
+            }                                                                              \
+            name##_impl_rebalance_remove(tree_obj, dir, rot_node);                         \
+        }                                                                                  \
+    }                                                                                      \
+    else                                                                                   \
+    {                                                                                      \
+        name##_node *rep_node = NULL;                                                      \
+        /* not a leaf node, removal by replacement */                                      \
+        /* at least one child, or a child and a subtree, or two subtrees */                \
+        /* find replacement node */                                                        \
+        if (rm_node->balance == -1)                                                        \
+        {                                                                                  \
+            rep_node = rm_node->less;                                                      \
+            while (rep_node->greater != NULL)                                              \
+            {                                                                              \
+                rep_node = rep_node->greater;                                              \
+            }                                                                              \
+        }                                                                                  \
+        else                                                                               \
+        {                                                                                  \
+            rep_node = rm_node->greater;                                                   \
+            while (rep_node->less != NULL)                                                 \
+            {                                                                              \
+                rep_node = rep_node->less;                                                 \
+            }                                                                              \
+        }                                                                                  \
+        name##_node *rot_node = rep_node->parent;                                          \
+        qtree_def_dir  dir;                                                                \
+        if (rot_node->less == rep_node)                                                    \
+        {                                                                                  \
+            /* node to remove is in the left subtree */                                    \
+            /* of its parent */                                                            \
+                                                                                           \
+            /* save direction */                                                           \
+            dir = QTREE_DEF_DIR_LESS;                                                      \
+                                                                                           \
+            if (rep_node->less != NULL)                                                    \
+            {                                                                              \
+                /* replace node by its left child */                                       \
+                rot_node->less         = rep_node->less;                                   \
+                rep_node->less->parent = rot_node;                                         \
+            }                                                                              \
+            else                                                                           \
+            if (rep_node->greater != NULL)                                                 \
+            {                                                                              \
+                /* replace node by its right child */                                      \
+                rot_node->less            = rep_node->greater;                             \
+                rep_node->greater->parent = rot_node;                                      \
+            }                                                                              \
+            else                                                                           \
+            {                                                                              \
+                /* non-root leaf node */                                                   \
+                rot_node->less = NULL;                                                     \
+            }                                                                              \
+        }                                                                                  \
+        else                                                                               \
+        {                                                                                  \
+            /* node to remove is in the right subtree */                                   \
+            /* of its parent */                                                            \
+                                                                                           \
+            /* save direction */                                                           \
+            dir = QTREE_DEF_DIR_GREATER;                                                   \
+                                                                                           \
+            if (rep_node->less != NULL)                                                    \
+            {                                                                              \
+                /* replace node by its left child */                                       \
+                rot_node->greater      = rep_node->less;                                   \
+                rep_node->less->parent = rot_node;                                         \
+            }                                                                              \
+            else                                                                           \
+            if (rep_node->greater != NULL)                                                 \
+            {                                                                              \
+                /* replace node by its right child */                                      \
+                rot_node->greater         = rep_node->greater;                             \
+                rep_node->greater->parent = rot_node;                                      \
+            }                                                                              \
+            else                                                                           \
+            {                                                                              \
+                /* non-root leaf node */                                                   \
+                rot_node->greater = NULL;                                                  \
+            }                                                                              \
+        }                                                                                  \
+                                                                                           \
+        /* replace node contents */                                                        \
+        if (rm_node->parent == NULL)                                                       \
+        {                                                                                  \
+            /* Node to be removed is the root node */                                      \
+            tree_obj->root = rep_node;                                                     \
+        }                                                                                  \
+        else                                                                               \
+        {                                                                                  \
+            if (rm_node->parent->less == rm_node)                                          \
+            {                                                                              \
+                rm_node->parent->less = rep_node;                                          \
+            }                                                                              \
+            else                                                                           \
+            {                                                                              \
+                rm_node->parent->greater = rep_node;                                       \
+            }                                                                              \
+        }                                                                                  \
+        if (rm_node->less != NULL)                                                         \
+        {                                                                                  \
+            rm_node->less->parent = rep_node;                                              \
+        }                                                                                  \
+        if (rm_node->greater != NULL)                                                      \
+        {                                                                                  \
+            rm_node->greater->parent = rep_node;                                           \
+        }                                                                                  \
+        rep_node->parent  = rm_node->parent;                                               \
+        rep_node->less    = rm_node->less;                                                 \
+        rep_node->greater = rm_node->greater;                                              \
+        rep_node->balance = rm_node->balance;                                              \
+                                                                                           \
+        if (rot_node == rm_node)                                                           \
+        {                                                                                  \
+            rot_node = rep_node;                                                           \
+        }                                                                                  \
+                                                                                           \
+        name##_impl_rebalance_remove(tree_obj, dir, rot_node);                             \
+    }                                                                                      \
+}                                                                                          \
+                                                                                           \
+                                                                                           \
+static inline name##_node *name##_impl_find_node(const name *tree_obj, const key_type key) \
+{                                                                                          \
+    name##_node *node = tree_obj->root;                                                    \
+    while (node != NULL)                                                                   \
+    {                                                                                      \
+        int cmp_rc = cmp_macro(key, node->key);                                            \
+        if (cmp_rc < 0)                                                                    \
+        {                                                                                  \
+            node = node->less;                                                             \
+        }                                                                                  \
+        else                                                                               \
+        if (cmp_rc > 0)                                                                    \
+        {                                                                                  \
+            node = node->greater;                                                          \
+        }                                                                                  \
+        else                                                                               \
+        {                                                                                  \
+            break;                                                                         \
+        }                                                                                  \
+    }                                                                                      \
+                                                                                           \
+    return node;                                                                           \
+}                                                                                          \
+                                                                                           \
+                                                                                           \
+static inline void name##_impl_init(name *tree_obj)                                        \
+{                                                                                          \
+    tree_obj->root      = NULL;                                                            \
+    tree_obj->size      = 0;                                                               \
+}                                                                                          \
+                                                                                           \
+                                                                                           \
+static inline void name##_impl_iterator_init(const name *tree_obj, name##_it *iter)        \
+{                                                                                          \
+    if (tree_obj->root != NULL)                                                            \
+    {                                                                                      \
+        iter->next = tree_obj->root;                                                       \
+        while (iter->next->less != NULL)                                                   \
+        {                                                                                  \
+            iter->next = iter->next->less;                                                 \
+        }                                                                                  \
+    }                                                                                      \
+    else                                                                                   \
+    {                                                                                      \
+        iter->next = NULL;                                                                 \
+    }                                                                                      \
+}                                                                                          \
+                                                                                           \
+                                                                                           \
+static inline void name##_impl_clear(name *tree_obj)                                       \
+{                                                                                          \
+    if (tree_obj != NULL)                                                                  \
+    {                                                                                      \
+        name##_node *node = tree_obj->root;                                                \
+                                                                                           \
+        while (node != NULL)                                                               \
+        {                                                                                  \
+            if (node->less != NULL)                                                        \
+            {                                                                              \
+                node = node->less;                                                         \
+            }                                                                              \
+            else                                                                           \
+            if (node->greater != NULL)                                                     \
+            {                                                                              \
+                node = node->greater;                                                      \
+            }                                                                              \
+            else                                                                           \
+            {                                                                              \
+                name##_node *leaf = node;                                                  \
+                node = node->parent;                                                       \
+                if (node != NULL)                                                          \
+                {                                                                          \
+                    if (leaf == node->less)                                                \
+                    {                                                                      \
+                        node->less = NULL;                                                 \
+                    }                                                                      \
+                    else                                                                   \
+                    {                                                                      \
+                        node->greater = NULL;                                              \
+                    }                                                                      \
+                }                                                                          \
+                free(leaf);                                                                \
+            }                                                                              \
+        }                                                                                  \
+    }                                                                                      \
+}
+
+#endif	/* QTREE_DEF_H */
@@ -0,0 +1,428 @@
+/**
+ * Memory-mappable image of a qtree
+ *
+ * @version 2026-10-16_001
+ * @author  Robert Altnoeder (r.altnoeder@gmx.net)
+ *
+ * Copyright (C) 2026 Robert ALTNOEDER
+ *
+ * Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that
+ * the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "qtree_image.h"
+
+/**
+ * Image layout
+ *
+ * The image consists of a header, followed by the keys of all entries in
+ * ascending order, followed by the values of all entries in the same order.
+ * All keys and all values have the same size, and the areas are located by
+ * offsets from the start of the image, so the image can be mapped at any
+ * address. A lookup is a binary search on the key area, which is the same
+ * descent as on a perfectly balanced tree whose child positions are implied
+ * by the key order, and range iteration reads the areas sequentially.
+ * Integers are stored in the byte order of the machine that wrote the image.
+ */
+static const unsigned char QTREE_IMAGE_MAGIC[8] = {'Q', 'T', 'R', 'E', 'E', 'I', 'M', 'G'};
+static const uint32_t QTREE_IMAGE_VERSION    = 1;
+static const uint32_t QTREE_IMAGE_BYTE_ORDER = 0x01020304;
+static const uint64_t QTREE_IMAGE_ALIGNMENT  = 8;
+
+typedef struct qtree_image_header_s qtree_image_header;
+
+struct qtree_image_header_s
+{
+    unsigned char   magic[8];
+    uint32_t        version;
+    uint32_t        byte_order;
+    uint64_t        entry_count;
+    uint64_t        key_size;
+    uint64_t        value_size;
+    uint64_t        keys_offset;
+    uint64_t        values_offset;
+    uint64_t        image_size;
+};
+
+static inline size_t qtree_image_impl_find(
+    const qtree_image   *image,
+    const void          *key,
+    bool                inclusive,
+    bool                *found
+);
+static inline bool   qtree_image_impl_write_area(
+    FILE            *file,
+    const qtree     *qtree_obj,
+    bool            write_keys,
+    size_t          data_size
+);
+static inline bool   qtree_image_impl_pad(FILE *file, uint64_t length);
+
+
+/**
+ * Writes the entries of a tree to an image file
+ *
+ * Each key must reference key_size bytes, and each value must reference value_size
+ * bytes or be NULL, in which case the value is stored as zero bytes.
+ */
+qtree_image_rc qtree_image_write(
+    const qtree     *qtree_obj,
+    const char      *path,
+    const size_t    key_size,
+    const size_t    value_size
+)
+{
+    qtree_image_rc rc = QTREE_IMAGE_PASS;
+
+    const uint64_t entry_count  = qtree_obj->size;
+    const uint64_t header_size  = sizeof (qtree_image_header);
+    const uint64_t keys_offset  = header_size + (QTREE_IMAGE_ALIGNMENT - header_size % QTREE_IMAGE_ALIGNMENT) %
+        QTREE_IMAGE_ALIGNMENT;
+    if (key_size == 0 || (entry_count > 0 && (key_size > SIZE_MAX / entry_count ||
+        value_size > SIZE_MAX / entry_count)))
+    {
+        rc = QTREE_IMAGE_ERR_FORMAT;
+    }
+    else
+    {
+        const uint64_t keys_end      = keys_offset + entry_count * key_size;
+        const uint64_t values_offset = keys_end + (QTREE_IMAGE_ALIGNMENT - keys_end % QTREE_IMAGE_ALIGNMENT) %
+            QTREE_IMAGE_ALIGNMENT;
+
+        qtree_image_header header;
+        memset(&header, 0, sizeof (header));
+        memcpy(header.magic, QTREE_IMAGE_MAGIC, sizeof (header.magic));
+        header.version       = QTREE_IMAGE_VERSION;
+        header.byte_order    = QTREE_IMAGE_BYTE_ORDER;
+        header.entry_count   = entry_count;
+        header.key_size      = key_size;
+        header.value_size    = value_size;
+        header.keys_offset   = keys_offset;
+        header.values_offset = values_offset;
+        header.image_size    = values_offset + entry_count * value_size;
+
+        FILE *file = fopen(path, "wb");
+        if (file != NULL)
+        {
+            bool write_ok = fwrite(&header, sizeof (header), 1, file) == 1 &&
+                qtree_image_impl_pad(file, keys_offset - header_size) &&
+                qtree_image_impl_write_area(file, qtree_obj, true, key_size) &&
+                qtree_image_impl_pad(file, values_offset - keys_end) &&
+                qtree_image_impl_write_area(file, qtree_obj, false, value_size);
+            if (fclose(file) != 0)
+            {
+                write_ok = false;
+            }
+            if (!write_ok)
+            {
+                rc = QTREE_IMAGE_ERR_IO;
+            }
+        }
+        else
+        {
+            rc = QTREE_IMAGE_ERR_IO;
+        }
+    }
+
+    return rc;
+}
+
+
+/**
+ * Maps an image file into memory for read-only access
+ *
+ * No memory is allocated for the entries, which are accessed directly in the mapping.
+ * cmp_func_ptr must order keys in the same way as the comparator of the tree that
+ * the image was written from.
+ */
+qtree_image_rc qtree_image_open(qtree_image *image, const char *path, const qtree_cmp_func cmp_func_ptr)
+{
+    qtree_image_rc rc = QTREE_IMAGE_PASS;
+
+    image->map_addr   = NULL;
+    image->map_size   = 0;
+    image->size       = 0;
+    image->key_size   = 0;
+    image->value_size = 0;
+    image->keys       = NULL;
+    image->values     = NULL;
+    image->image_cmp  = cmp_func_ptr;
+
+    const int file_fd = open(path, O_RDONLY);
+    if (file_fd != -1)
+    {
+        struct stat file_info;
+        if (fstat(file_fd, &file_info) == 0 && (uint64_t) file_info.st_size >= sizeof (qtree_image_header) &&
+            (uint64_t) file_info.st_size <= SIZE_MAX)
+        {
+            const size_t map_size = (size_t) file_info.st_size;
+            void *map_addr = mmap(NULL, map_size, PROT_READ, MAP_SHARED, file_fd, 0);
+            if (map_addr != MAP_FAILED)
+            {
+                const qtree_image_header *header = map_addr;
+                // Validate the header, all areas must be within the mapping
+                bool valid = memcmp(header->magic, QTREE_IMAGE_MAGIC, sizeof (header->magic)) == 0 &&
+                    header->version == QTREE_IMAGE_VERSION &&
+                    header->byte_order == QTREE_IMAGE_BYTE_ORDER &&
+                    header->key_size > 0 &&
+                    header->image_size <= map_size &&
+                    header->keys_offset >= sizeof (qtree_image_header) &&
+                    header->keys_offset <= header->values_offset &&
+                    header->values_offset <= header->image_size;
+                if (valid && header->entry_count > 0)
+                {
+                    valid = header->entry_count <= (header->values_offset - header->keys_offset) /
+                        header->key_size;
+                    if (valid && header->value_size > 0)
+                    {
+                        valid = header->entry_count <= (header->image_size - header->values_offset) /
+                            header->value_size;
+                    }
+                }
+
+                if (valid)
+                {
+                    const unsigned char *base = map_addr;
+                    image->map_addr   = map_addr;
+                    image->map_size   = map_size;
+                    image->size       = (size_t) header->entry_count;
+                    image->key_size   = (size_t) header->key_size;
+                    image->value_size = (size_t) header->value_size;
+                    image->keys       = base + header->keys_offset;
+                    image->values     = base + header->values_offset;
+                }
+                else
+                {
+                    munmap(map_addr, map_size);
+                    rc = QTREE_IMAGE_ERR_FORMAT;
+                }
+            }
+            else
+            {
+                rc = QTREE_IMAGE_ERR_NOMEM;
+            }
+        }
+        else
+        {
+            rc = QTREE_IMAGE_ERR_FORMAT;
+        }
+        close(file_fd);
+    }
+    else
+    {
+        rc = QTREE_IMAGE_ERR_IO;
+    }
+
+    return rc;
+}
+
+
+void qtree_image_close(qtree_image *image)
+{
+    if (image->map_addr != NULL)
+    {
+        munmap(image->map_addr, image->map_size);
+    }
+    image->map_addr = NULL;
+    image->map_size = 0;
+    image->size     = 0;
+    image->keys     = NULL;
+    image->values   = NULL;
+}
+
+
+/**
+ * Returns a pointer to the value of the entry with the specified key, or NULL if
+ * there is no such entry
+ *
+ * If the image has a value size of zero, a pointer to the entry's key is returned.
+ */
+const void *qtree_image_get(const qtree_image *image, const void *key)
+{
+    const void *value = NULL;
+
+    bool found = false;
+    const size_t idx = qtree_image_impl_find(image, key, true, &found);
+    if (found)
+    {
+        if (image->value_size > 0)
+        {
+            value = image->values + idx * image->value_size;
+        }
+        else
+        {
+            value = image->keys + idx * image->key_size;
+        }
+    }
+
+    return value;
+}
+
+
+size_t qtree_image_get_size(const qtree_image *image)
+{
+    return image->size;
+}
+
+
+void qtree_image_iterator_init(const qtree_image *image, qtree_image_it *iter)
+{
+    iter->image = image;
+    iter->next  = 0;
+    iter->end   = image->size;
+}
+
+
+/**
+ * Initializes an iterator that returns the entries with keys from start_key up
+ * to and including end_key
+ */
+void qtree_image_range_iterator_init(
+    const qtree_image   *image,
+    qtree_image_it      *iter,
+    const void          *start_key,
+    const void          *end_key
+)
+{
+    bool found = false;
+    iter->image = image;
+    iter->next  = qtree_image_impl_find(image, start_key, true, &found);
+    iter->end   = qtree_image_impl_find(image, end_key, false, &found);
+    if (iter->next > iter->end)
+    {
+        iter->next = iter->end;
+    }
+}
+
+
+/**
+ * Retrieves the next entry of an iterator
+ *
+ * @return true if an entry was retrieved, false if the iterator is exhausted
+ */
+bool qtree_image_next(qtree_image_it *iter, const void **key, const void **value)
+{
+    bool have_entry = false;
+    if (iter->next < iter->end)
+    {
+        const qtree_image *image = iter->image;
+        *key = image->keys + iter->next * image->key_size;
+        if (value != NULL)
+        {
+            *value = image->value_size > 0 ? image->values + iter->next * image->value_size : NULL;
+        }
+        ++(iter->next);
+        have_entry = true;
+    }
+    return have_entry;
+}
+
+
+/**
+ * @return index of the first key that is greater than or equal to the specified key,
+ *         or if inclusive is not set, index of the first key that is greater than the
+ *         specified key
+ */
+static inline size_t qtree_image_impl_find(
+    const qtree_image   *image,
+    const void          *key,
+    const bool          inclusive,
+    bool                *found
+)
+{
+    size_t start_idx = 0;
+    size_t end_idx   = image->size;
+    while (start_idx < end_idx)
+    {
+        const size_t mid_idx = start_idx + (end_idx - start_idx) / 2;
+        const int cmp_rc = image->image_cmp(key, image->keys + mid_idx * image->key_size);
+        if (cmp_rc < 0 || (cmp_rc == 0 && inclusive))
+        {
+            if (cmp_rc == 0)
+            {
+                *found = true;
+            }
+            end_idx = mid_idx;
+        }
+        else
+        {
+            start_idx = mid_idx + 1;
+        }
+    }
+    return start_idx;
+}
+
+
+/**
+ * Writes the keys or the values of all entries in ascending order of keys
+ */
+static inline bool qtree_image_impl_write_area(
+    FILE            *file,
+    const qtree     *qtree_obj,
+    const bool      write_keys,
+    const size_t    data_size
+)
+{
+    bool write_ok = true;
+    if (data_size > 0)
+    {
+        qtree_it iter;
+        qtree_iterator_init(qtree_obj, &iter);
+        const qtree_node *node = qtree_next(&iter);
+        while (node != NULL && write_ok)
+        {
+            const void *data = write_keys ? node->key : node->value;
+            if (data != NULL)
+            {
+                write_ok = fwrite(data, data_size, 1, file) == 1;
+            }
+            else
+            {
+                write_ok = qtree_image_impl_pad(file, data_size);
+            }
+            node = qtree_next(&iter);
+        }
+    }
+    return write_ok;
+}
+
+
+/**
+ * Writes the specified number of zero bytes
+ */
+static inline bool qtree_image_impl_pad(FILE *file, uint64_t length)
+{
+    bool write_ok = true;
+    while (length > 0 && write_ok)
+    {
+        write_ok = fputc(0, file) != EOF;
+        --length;
+    }
+    return write_ok;
+}
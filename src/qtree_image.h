@@ -0,0 +1,61 @@
+#ifndef QTREE_IMAGE_H
+#define	QTREE_IMAGE_H
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "qtree.h"
+
+typedef enum
+{
+    QTREE_IMAGE_PASS       = 0,
+    QTREE_IMAGE_ERR_NOMEM  = 1,
+    QTREE_IMAGE_ERR_IO     = 2,
+    QTREE_IMAGE_ERR_FORMAT = 3
+}
+qtree_image_rc;
+
+typedef struct qtree_image_s    qtree_image;
+typedef struct qtree_image_it_s qtree_image_it;
+
+struct qtree_image_s
+{
+    void                *map_addr;
+    size_t              map_size;
+    size_t              size;
+    size_t              key_size;
+    size_t              value_size;
+    const unsigned char *keys;
+    const unsigned char *values;
+    qtree_cmp_func      image_cmp;
+};
+
+struct qtree_image_it_s
+{
+    const qtree_image   *image;
+    size_t              next;
+    size_t              end;
+};
+
+qtree_image_rc  qtree_image_write(
+    const qtree *qtree_obj,
+    const char  *path,
+    size_t      key_size,
+    size_t      value_size
+);
+qtree_image_rc  qtree_image_open(qtree_image *image, const char *path, qtree_cmp_func cmp_func_ptr);
+void            qtree_image_close(qtree_image *image);
+const void      *qtree_image_get(const qtree_image *image, const void *key);
+size_t          qtree_image_get_size(const qtree_image *image);
+void            qtree_image_iterator_init(const qtree_image *image, qtree_image_it *iter);
+void            qtree_image_range_iterator_init(
+    const qtree_image   *image,
+    qtree_image_it      *iter,
+    const void          *start_key,
+    const void          *end_key
+);
+bool            qtree_image_next(qtree_image_it *iter, const void **key, const void **value);
+
+#endif	/* QTREE_IMAGE_H */
@@ -0,0 +1,11 @@
+#ifndef QTREE_INT_H
+#define	QTREE_INT_H
+
+#include <stdint.h>
+
+#include "qtree_def.h"
+
+QTREE_DECLARE(qtree_u64, uint64_t)
+QTREE_DECLARE(qtree_u32, uint32_t)
+
+#endif	/* QTREE_INT_H */
@@ -0,0 +1,365 @@
+/**
+ * Range-sharded qtree with a lock per shard
+ *
+ * @version 2026-10-16_001
+ * @author  Robert Altnoeder (r.altnoeder@gmx.net)
+ *
+ * Copyright (C) 2026 Robert ALTNOEDER
+ *
+ * Redistribution and use in source and binary forms,
+ * with or without modification, are permitted provided that
+ * the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <sched.h>
+
+#include "qtree_shard.h"
+
+/**
+ * Shards
+ *
+ * The key space is divided into contiguous ranges, each of which is stored in
+ * a separate qtree protected by its own mutex, so that modifications of keys
+ * in different ranges proceed in parallel. Part i holds the keys from bound
+ * i - 1 up to, but not including, bound i. The bounds are copies of keys, so
+ * that entries can be removed and their keys freed independently of the bounds.
+ *
+ * The bounds only change while rebalancing, which holds the locks of all parts
+ * and makes the sequence number odd. An operation selects its part without a
+ * lock, locks it, and retries if the sequence number has changed meanwhile.
+ * Since the bounds may be overwritten while a part is being selected, their
+ * bytes are stored and loaded atomically, and the comparator is only called
+ * with a private copy of a bound.
+ *
+ * Until the first rebalance, all entries are stored in the first part. A part
+ * that grows significantly larger than its share triggers a rebalance, which
+ * redistributes the entries evenly.
+ */
+
+// Entries a part may hold in excess of its share before a rebalance is triggered
+#define QTREE_SHARD_REBALANCE_MIN   1024
+// Interval of part sizes at which an insertion checks for skew
+#define QTREE_SHARD_CHECK_INTERVAL  256
+
+static inline qtree_shard_part *qtree_shard_impl_lock_part(qtree_shard *shard_obj, const void *key);
+static inline size_t           qtree_shard_impl_part_index(const qtree_shard *shard_obj, const void *key);
+static inline void             qtree_shard_impl_store_bound(qtree_shard *shard_obj, size_t idx, const void *key);
+static inline bool             qtree_shard_impl_is_skewed(const qtree_shard *shard_obj, size_t part_size);
+static inline void             qtree_shard_impl_lock_all(qtree_shard *shard_obj);
+static inline void             qtree_shard_impl_unlock_all(qtree_shard *shard_obj);
+
+
+qtree_shard *qtree_shard_alloc(const qtree_cmp_func cmp_func_ptr, const size_t key_size, const size_t part_count)
+{
+    qtree_shard *shard_obj = NULL;
+    if (part_count > 0 && key_size > 0)
+    {
+        shard_obj = malloc(sizeof (qtree_shard));
+        if (shard_obj != NULL)
+        {
+            shard_obj->parts       = malloc(sizeof (qtree_shard_part) * part_count);
+            shard_obj->bounds      = malloc(key_size * part_count);
+            shard_obj->part_count  = 0;
+            shard_obj->bound_count = 0;
+            shard_obj->key_size    = key_size;
+            shard_obj->seq         = 0;
+            shard_obj->shard_cmp   = cmp_func_ptr;
+            if (shard_obj->parts != NULL && shard_obj->bounds != NULL)
+            {
+                while (shard_obj->part_count < part_count)
+                {
+                    qtree_shard_part *part = &(shard_obj->parts[shard_obj->part_count]);
+                    if (pthread_mutex_init(&(part->lock), NULL) != 0)
+                    {
+                        break;
+                    }
+                    // Splitting a part requires the sizes of its subtrees
+                    qtree_init_opt(&(part->tree), cmp_func_ptr, QTREE_OPT_ORDER_STATS);
+                    ++(shard_obj->part_count);
+                }
+            }
+            if (shard_obj->part_count < part_count)
+            {
+                qtree_shard_dealloc(shard_obj);
+                shard_obj = NULL;
+            }
+        }
+    }
+
+    return shard_obj;
+}
+
+
+void qtree_shard_dealloc(qtree_shard *shard_obj)
+{
+    if (shard_obj != NULL)
+    {
+        for (size_t idx = 0; idx < shard_obj->part_count; ++idx)
+        {
+            qtree_shard_part *part = &(shard_obj->parts[idx]);
+            qtree_clear(&(part->tree));
+            pthread_mutex_destroy(&(part->lock));
+        }
+        free(shard_obj->parts);
+        free(shard_obj->bounds);
+    }
+    free(shard_obj);
+}
+
+
+void qtree_shard_clear(qtree_shard *shard_obj)
+{
+    qtree_shard_impl_lock_all(shard_obj);
+    for (size_t idx = 0; idx < shard_obj->part_count; ++idx)
+    {
+        qtree_clear(&(shard_obj->parts[idx].tree));
+    }
+    qtree_shard_impl_unlock_all(shard_obj);
+}
+
+
+qtree_rc qtree_shard_insert(qtree_shard *shard_obj, const void *key, const void *value)
+{
+    qtree_shard_part *part = qtree_shard_impl_lock_part(shard_obj, key);
+    const qtree_rc rc = qtree_insert(&(part->tree), key, value);
+    const size_t part_size = part->tree.size;
+    pthread_mutex_unlock(&(part->lock));
+
+    if (rc == QTREE_PASS && part_size % QTREE_SHARD_CHECK_INTERVAL == 0 &&
+        qtree_shard_impl_is_skewed(shard_obj, part_size))
+    {
+        qtree_shard_rebalance(shard_obj);
+    }
+
+    return rc;
+}
+
+
+void qtree_shard_remove(qtree_shard *shard_obj, const void *key)
+{
+    qtree_shard_part *part = qtree_shard_impl_lock_part(shard_obj, key);
+    qtree_remove(&(part->tree), key);
+    pthread_mutex_unlock(&(part->lock));
+}
+
+
+void *qtree_shard_get(qtree_shard *shard_obj, const void *key)
+{
+    qtree_shard_part *part = qtree_shard_impl_lock_part(shard_obj, key);
+    void *value = qtree_get(&(part->tree), key);
+    pthread_mutex_unlock(&(part->lock));
+
+    return value;
+}
+
+
+/**
+ * Redistributes the entries evenly across all parts
+ *
+ * Holds the locks of all parts. The parts are joined, the new bounds are
+ * selected and the parts are split in O(log n) each.
+ */
+void qtree_shard_rebalance(qtree_shard *shard_obj)
+{
+    qtree_shard_impl_lock_all(shard_obj);
+    __atomic_store_n(&(shard_obj->seq), shard_obj->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    qtree *all_tree = &(shard_obj->parts[0].tree);
+    for (size_t idx = 1; idx < shard_obj->part_count; ++idx)
+    {
+        qtree_join(all_tree, &(shard_obj->parts[idx].tree));
+    }
+
+    const size_t size = all_tree->size;
+    __atomic_store_n(
+        &(shard_obj->bound_count), size >= shard_obj->part_count ? shard_obj->part_count - 1 : 0, __ATOMIC_RELAXED
+    );
+    if (shard_obj->bound_count > 0)
+    {
+        // Record the key at position size * (idx + 1) / part_count for each bound
+        for (size_t idx = 0; idx < shard_obj->bound_count; ++idx)
+        {
+            const size_t bound_idx = size / shard_obj->part_count * (idx + 1) +
+                size % shard_obj->part_count * (idx + 1) / shard_obj->part_count;
+            const qtree_node *node = qtree_select(all_tree, bound_idx);
+            qtree_shard_impl_store_bound(shard_obj, idx, node->key);
+        }
+
+        for (size_t idx = shard_obj->bound_count; idx > 0; --idx)
+        {
+            qtree_split(
+                all_tree, shard_obj->bounds + (idx - 1) * shard_obj->key_size,
+                all_tree, &(shard_obj->parts[idx].tree)
+            );
+        }
+    }
+
+    __atomic_store_n(&(shard_obj->seq), shard_obj->seq + 1, __ATOMIC_RELEASE);
+    qtree_shard_impl_unlock_all(shard_obj);
+}
+
+
+/**
+ * Initializes an iterator that returns the entries of all parts in ascending order
+ *
+ * The iterator must not be used while the tree is being modified.
+ */
+void qtree_shard_iterator_init(const qtree_shard *shard_obj, qtree_shard_it *iter)
+{
+    iter->shard_obj = shard_obj;
+    iter->part_idx  = 0;
+    qtree_iterator_init(&(shard_obj->parts[0].tree), &(iter->part_iter));
+}
+
+
+qtree_node *qtree_shard_next(qtree_shard_it *iter)
+{
+    qtree_node *node = qtree_next(&(iter->part_iter));
+    while (node == NULL && iter->part_idx + 1 < iter->shard_obj->part_count)
+    {
+        // The parts hold consecutive key ranges
+        ++(iter->part_idx);
+        qtree_iterator_init(&(iter->shard_obj->parts[iter->part_idx].tree), &(iter->part_iter));
+        node = qtree_next(&(iter->part_iter));
+    }
+    return node;
+}
+
+
+/**
+ * Returns the number of entries, which is approximate while the tree is being modified
+ */
+size_t qtree_shard_get_size(const qtree_shard *shard_obj)
+{
+    size_t size = 0;
+    for (size_t idx = 0; idx < shard_obj->part_count; ++idx)
+    {
+        size += __atomic_load_n(&(shard_obj->parts[idx].tree.size), __ATOMIC_RELAXED);
+    }
+    return size;
+}
+
+
+/**
+ * Locks and returns the part that holds the specified key
+ */
+static inline qtree_shard_part *qtree_shard_impl_lock_part(qtree_shard *shard_obj, const void *key)
+{
+    qtree_shard_part *part = NULL;
+    while (part == NULL)
+    {
+        const size_t seq = __atomic_load_n(&(shard_obj->seq), __ATOMIC_ACQUIRE);
+        if ((seq & 1) == 0)
+        {
+            part = &(shard_obj->parts[qtree_shard_impl_part_index(shard_obj, key)]);
+            pthread_mutex_lock(&(part->lock));
+            // Orders the loads of the bounds before the check of the sequence number
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&(shard_obj->seq), __ATOMIC_RELAXED) != seq)
+            {
+                // The bounds were changed by a rebalance
+                pthread_mutex_unlock(&(part->lock));
+                part = NULL;
+            }
+        }
+        else
+        {
+            // A rebalance holds the locks of all parts, so there is no point in spinning
+            sched_yield();
+        }
+    }
+    return part;
+}
+
+
+/**
+ * @return index of the first part whose bound is greater than the specified key
+ */
+static inline size_t qtree_shard_impl_part_index(const qtree_shard *shard_obj, const void *key)
+{
+    size_t start_idx = 0;
+    size_t end_idx   = __atomic_load_n(&(shard_obj->bound_count), __ATOMIC_RELAXED);
+    if (end_idx >= shard_obj->part_count)
+    {
+        // Inconsistent read during a rebalance, the caller retries
+        end_idx = 0;
+    }
+    unsigned char bound[shard_obj->key_size];
+    while (start_idx < end_idx)
+    {
+        const size_t mid_idx = start_idx + (end_idx - start_idx) / 2;
+        const unsigned char *src_bound = shard_obj->bounds + mid_idx * shard_obj->key_size;
+        for (size_t byte_idx = 0; byte_idx < shard_obj->key_size; ++byte_idx)
+        {
+            bound[byte_idx] = __atomic_load_n(&(src_bound[byte_idx]), __ATOMIC_RELAXED);
+        }
+        if (shard_obj->shard_cmp(key, bound) < 0)
+        {
+            end_idx = mid_idx;
+        }
+        else
+        {
+            start_idx = mid_idx + 1;
+        }
+    }
+    return start_idx;
+}
+
+
+/**
+ * Copies a key into the bound with the specified index while the sequence number is odd
+ */
+static inline void qtree_shard_impl_store_bound(qtree_shard *shard_obj, const size_t idx, const void *key)
+{
+    unsigned char *dst_bound = shard_obj->bounds + idx * shard_obj->key_size;
+    const unsigned char *key_bytes = key;
+    for (size_t byte_idx = 0; byte_idx < shard_obj->key_size; ++byte_idx)
+    {
+        __atomic_store_n(&(dst_bound[byte_idx]), key_bytes[byte_idx], __ATOMIC_RELAXED);
+    }
+}
+
+
+static inline bool qtree_shard_impl_is_skewed(const qtree_shard *shard_obj, const size_t part_size)
+{
+    const size_t share = qtree_shard_get_size(shard_obj) / shard_obj->part_count;
+    return shard_obj->part_count > 1 && part_size > share + share / 2 + QTREE_SHARD_REBALANCE_MIN;
+}
+
+
+static inline void qtree_shard_impl_lock_all(qtree_shard *shard_obj)
+{
+    // Always locked in ascending order, so that concurrent rebalances cannot deadlock
+    for (size_t idx = 0; idx < shard_obj->part_count; ++idx)
+    {
+        pthread_mutex_lock(&(shard_obj->parts[idx].lock));
+    }
+}
+
+
+static inline void qtree_shard_impl_unlock_all(qtree_shard *shard_obj)
+{
+    for (size_t idx = 0; idx < shard_obj->part_count; ++idx)
+    {
+        pthread_mutex_unlock(&(shard_obj->parts[idx].lock));
+    }
+}
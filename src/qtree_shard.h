@@ -0,0 +1,58 @@
+#ifndef QTREE_SHARD_H
+#define	QTREE_SHARD_H
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "qtree.h"
+
+#define QTREE_SHARD_CACHE_LINE 64
+
+typedef struct qtree_shard_s        qtree_shard;
+typedef struct qtree_shard_part_s   qtree_shard_part;
+typedef struct qtree_shard_it_s     qtree_shard_it;
+
+struct qtree_shard_s
+{
+    qtree_shard_part    *parts;
+    size_t              part_count;
+    unsigned char       *bounds;
+    size_t              bound_count;
+    size_t              key_size;
+    size_t              seq;
+    qtree_cmp_func      shard_cmp;
+};
+
+struct qtree_shard_part_s
+{
+    pthread_mutex_t     lock;
+    qtree               tree;
+    unsigned char       padding[QTREE_SHARD_CACHE_LINE];
+};
+
+struct qtree_shard_it_s
+{
+    const qtree_shard   *shard_obj;
+    size_t              part_idx;
+    qtree_it            part_iter;
+};
+
+void            qtree_shard_dealloc(qtree_shard *shard_obj);
+void            qtree_shard_clear(qtree_shard *shard_obj);
+qtree_shard     *qtree_shard_alloc(qtree_cmp_func cmp_func_ptr, size_t key_size, size_t part_count);
+qtree_rc        qtree_shard_insert(
+    qtree_shard *shard_obj,
+    const void  *key,
+    const void  *value
+);
+void            qtree_shard_remove(qtree_shard *shard_obj, const void *key);
+void            *qtree_shard_get(qtree_shard *shard_obj, const void *key);
+void            qtree_shard_rebalance(qtree_shard *shard_obj);
+void            qtree_shard_iterator_init(const qtree_shard *shard_obj, qtree_shard_it *iter);
+qtree_node      *qtree_shard_next(qtree_shard_it *iter);
+size_t          qtree_shard_get_size(const qtree_shard *shard_obj);
+
+#endif	/* QTREE_SHARD_H */